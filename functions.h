@@ -2,14 +2,28 @@
 #define FUNCTIONS_H
 
 #include <stdio.h> // Has to be included to use FILE
+#include <stdint.h> // Has to be included to use uint64_t
 #include "types.h" // Has to be included to use Frequency, Node and Code
 
 /*Function declarations--------------------------------------------------------------------------*/
-//Function to count the frequency of each character in the input file
-void countFrequencies(FILE *file, Frequency *char_frequency);
+//Function to load the whole input file, memory-mapped if possible, otherwise read in large chunks
+int loadInput(FILE *file, InputData *input);
+
+//Functions to get the size of a file and read at a position, for random access
+long long fileSize(FILE *file);
+int readAt(FILE *file, unsigned long long position, void *data, size_t length);
+
+//Function to release the memory of a loaded input
+void freeInput(InputData *input);
+
+//Function to count the frequency of each character in the input data
+void countFrequencies(const unsigned char *data, size_t length, Frequency *char_frequency);
+
+//Function to count the frequency of each character with a single count per character, used for short inputs
+void countFrequenciesSimple(const unsigned char *data, size_t length, Frequency *characterFrequency);
 
 //Function to remove all elements with a frequency of 0 from the array
-Frequency *removeZeroElements(Frequency *char_frequency, int new_size);
+Frequency *removeZeroElements(Frequency *char_frequency, int new_size, Arena *arena);
 
 //Function to count the number of non-zero elements in the array -> number of leaf nodes in the tree
 int countNonZero(Frequency *char_frequency, int size);
@@ -18,33 +32,267 @@ int countNonZero(Frequency *char_frequency, int size);
 int getFileType(char* filename);
 
 //Function to summarize compression statistics
-void summarizeCompression(FILE* input, FILE* output);
+void summarizeCompression(size_t inputLength, unsigned long long outputLength);
 
-//Function to find the smallest node in an array of nodes
-int findMinNode(Node* tree, int excludedIndex, int size);
+//Function to compare two nodes by frequency
+int nodeIsSmaller(Node* tree, int first, int second);
+
+//Function to add a node index to the min-heap
+void pushHeap(int* heap, int* heapSize, Node* tree, int index);
+
+//Function to remove the index of the smallest node from the min-heap
+int popHeap(int* heap, int* heapSize, Node* tree);
 
 //Function to build the Huffman tree
 Node* buildHuffmanTree(Node *tree, int *new_size, Frequency *char_frequency);
 
-//Function to build the code table containing character, code and code length
-void buildCodeTable(Node* tree, int index, Code* codeTable, char* currentCode, int depth);
+//Function to build the canonical code table containing character, code and code length
+int buildCodeTable(Node* tree, int root, Code* codeTable, int maxCodeLength);
+
+//Function to find the best code lengths of at most maxCodeLength bits with the package-merge algorithm
+void limitCodeLengths(Node* tree, int numberLeaves, Code* codeTable, int maxCodeLength);
+
+//Function to find the code length of every leaf of the Huffman tree
+void findCodeLengths(Node* tree, int index, Code* codeTable, int depth);
+
+//Function to assign canonical codes to a code table that only contains code lengths
+int assignCanonicalCodes(Code* codeTable);
+
+//Function to write the code lengths to the header of a compressed block
+int writeCodeTable2Buffer(ByteBuffer* output, Code* codeTable);
+
+//Function to reconstruct the code table from the header of a compressed block
+Code* reconstructCodeTableFromBuffer(const unsigned char* data, size_t length, size_t* position, int* tableSize, Arena* arena);
+
+//Function to initialise a bit writer that appends to a byte buffer
+void initBitWriter(BitWriter* writer, ByteBuffer* output);
+
+//Function to append a code to a bit writer
+int writeBits(BitWriter* writer, unsigned int code, int length);
+
+//Function to pad the last byte with zeros and move everything left in a bit writer to its buffer
+int flushBitWriter(BitWriter* writer);
+
+//Function to build the lookup table used to decode a whole code at once
+int buildDecodeTable(Code *codeTable, DecodeTable *decodeTable, Arena *arena);
+
+//Function to build the table decoding up to two codes per lookup for interleaved blocks
+void buildPairTable(const DecodeTable *decodeTable, DecodePair *pairs);
 
-//Function to write the code table and its size to the header of a binary output file
-void writeCodeTable2FileBinary(FILE* file, Code* codeTable, int tableSize);
+//Function to decode the bit stream of a block using the decode table
+int decodeBinaryBlock(const unsigned char *data, size_t length, unsigned char *output, size_t rawLength, const DecodeTable *decodeTable);
 
-//Function to reconstruct code table from binary file
-Code* reconstructCodeTableFromFileBinary(FILE* file, int* tableSize);
+//Function to load the next bits of a bit stream, padded with zeros at its end
+uint64_t peekBits(const unsigned char *data, size_t length, size_t bitPosition);
 
-//Function to write a binary string to a file
-void writeBinaryString2File(FILE* file, char index, Code* codeTable, int new_size);
+//Function to decode a block of interleaved bit streams
+int decodeInterleaved(const unsigned char *data, size_t length, unsigned char *output, size_t rawLength, const DecodeTable *decodeTable);
 
-//Function to decode a binary file using Huffman coding table
-void decodeBinaryFile(FILE *input, FILE *output, Code *codeTable, int tableSize);
+//Function to compress one block of the input into a byte buffer, in the block mode that gives the smallest output
+int compressBlock(const unsigned char *data, size_t length, int maxCodeLength, const BlockFormat *format, size_t blockIndex, TableReference *reference, Arena *arena, ByteBuffer *output, CodecStats *stats);
+
+//Functions to count the characters of a block, choose its block mode and write it in that mode
+int planBlock(const unsigned char *data, size_t length, int maxCodeLength, const BlockFormat *format, Arena *arena, BlockPlan *plan, CodecStats *stats);
+int chooseBlockMode(BlockPlan *plan, size_t length, const BlockFormat *format, size_t blockIndex, TableReference *reference, Arena *arena);
+int encodeBlock(const unsigned char *data, size_t length, const BlockFormat *format, const BlockPlan *plan, ByteBuffer *output, CodecStats *stats);
+
+//Functions to compute the size of a block coded with a code table, a lower bound of the size with its own table, and the size of the stored table
+long long encodedSize(const Frequency *frequency, const Code *codeTable, int numberStreams);
+long long ownTableBound(const Frequency *frequency, size_t length, int numberStreams);
+size_t codeTableSize(const Code *codeTable);
+
+//Function to encode a block as interleaved bit streams behind a jump table
+int encodeInterleaved(const unsigned char *data, size_t length, const Code *codeTable, ByteBuffer *output);
+
+//Function to build the code table of one block from its frequencies
+Code *buildBlockCodeTable(Frequency *characterFrequency0, int size, int maxCodeLength, Arena *arena, CodecStats *stats);
+
+//Function to decompress one block into a byte buffer
+int decompressBlock(const unsigned char *data, size_t length, size_t rawLength, size_t blockIndex, const BlockFormat *format, TableReference *reference, Arena *arena, ByteBuffer *output, CodecStats *stats);
+
+//Function to read the code table of an earlier block for blocks reusing it
+int loadTableReference(const unsigned char *data, size_t length, size_t owner, TableReference *reference, Arena *arena);
+
+//Function to fill codec options with the default block size and one thread per core
+void defaultCodecOptions(CodecOptions *options);
 
 //Function to compress the input file
-void compressFile(FILE *input, FILE *output);
+int compressFile(FILE *input, FILE *output, const CodecOptions *options);
 
 //Function to decompress the input file
-void decompressFile(FILE *input, FILE *output);
+int decompressFile(FILE *input, FILE *output, const CodecOptions *options);
+
+//Function to decompress a range of the uncompressed data, reading only the blocks that hold it
+int decompressRange(FILE *input, unsigned long long offset, unsigned long long length, const CodecOptions *options, ByteBuffer *output);
+
+//Function to read the frame of a block through the index of a compressed file
+int readFrame(FILE *input, unsigned long long indexOffset, unsigned long long b, size_t limit, ByteBuffer *frame);
+
+//Functions of the streaming encoder: input and output are caller-supplied buffers of any size, memory use stays bounded by the block size
+int initEncoder(HuffmanEncoder *encoder, const CodecOptions *options);
+int resetEncoder(HuffmanEncoder *encoder);
+int updateEncoder(HuffmanEncoder *encoder, const unsigned char *input, size_t inputLength, size_t *inputUsed, unsigned char *output, size_t outputCapacity, size_t *outputUsed);
+int finishEncoder(HuffmanEncoder *encoder, unsigned char *output, size_t outputCapacity, size_t *outputUsed, int *done);
+void freeEncoder(HuffmanEncoder *encoder);
+int encodeCollectedBlock(HuffmanEncoder *encoder);
+size_t drainPending(ByteBuffer *pending, size_t *pendingPosition, unsigned char *output, size_t outputCapacity);
+
+//Functions of the streaming decoder
+void initDecoder(HuffmanDecoder *decoder, const CodecOptions *options);
+void resetDecoder(HuffmanDecoder *decoder);
+int updateDecoder(HuffmanDecoder *decoder, const unsigned char *input, size_t inputLength, size_t *inputUsed, unsigned char *output, size_t outputCapacity, size_t *outputUsed);
+int finishDecoder(HuffmanDecoder *decoder);
+void freeDecoder(HuffmanDecoder *decoder);
+
+//Function to check the options of the compressor
+int checkCodecOptions(const CodecOptions *options);
+
+//Function to compress a stream such as stdin with the streaming encoder
+int compressStream(FILE *input, FILE *output, const CodecOptions *options);
+
+//Function to decompress a stream such as stdin with the streaming decoder
+int decompressStream(FILE *input, FILE *output, const CodecOptions *options);
+
+//Functions to (de-)compress one file with an encoder or decoder that is reset first, counting the bytes read and written
+int encodeFileStream(HuffmanEncoder *encoder, FILE *input, FILE *output, unsigned char *inBuffer, unsigned char *outBuffer, unsigned long long *inputTotal, unsigned long long *outputTotal);
+int decodeFileStream(HuffmanDecoder *decoder, FILE *input, FILE *output, unsigned char *inBuffer, unsigned char *outBuffer, unsigned long long *inputTotal, unsigned long long *outputTotal);
+
+//Function to (de-)compress many files on worker threads for the batch mode
+int runBatch(int mode, const char **inputNames, int numberInputs, const char *listName, const char *outputDirectory, const CodecOptions *options);
+
+//Function run by every worker thread of the batch mode
+void *batchWorker(void *argument);
+
+//Function to (de-)compress one file of the batch mode with the state of a worker
+int codeBatchFile(BatchWorker *worker, const char *inputName, const char *outputName, unsigned long long *inputBytes, unsigned long long *outputBytes);
+
+//Function to make the name of the output of a file in the batch mode
+char *batchOutputName(const char *inputName, int mode, const char *outputDirectory);
+
+//Functions to name the outputs of all files of the batch mode, files whose output is written by another file or read as its input cannot be coded
+int nameBatchOutputs(const FileList *files, int mode, const char *outputDirectory, char **outputNames);
+int compareBatchNames(const void *first, const void *second);
+
+//Functions to collect the files of the batch mode from the inputs, directories and list files
+int addBatchInput(FileList *list, const char *name, int mode);
+int listDirectory(const char *directory, int mode, FileList *list);
+int isDirectory(const char *name);
+int readFileList(FILE *file, FileList *list);
+void initFileList(FileList *list);
+int addFileName(FileList *list, const char *name, size_t length);
+void freeFileList(FileList *list);
+
+//Function to run the interactive mode asking for a file name
+int interactiveMode(void);
+
+//Function to run the command line mode
+int commandLineMode(int argc, char **argv);
+
+//Function to compress or decompress one input, or a range of it, to one output for the command line mode
+int codeFiles(int mode, const char *inputName, const char *outputName, unsigned long long rangeOffset, unsigned long long rangeLength, const CodecOptions *options);
+
+//Function to train a dictionary on sample files and write it to a file for the command line mode
+int trainDictionaryFiles(const char **inputNames, int numberInputs, const char *outputName, const CodecOptions *options);
+
+//Function to print the command line usage
+void printUsage(FILE *file);
+
+//Function to read one number of a range given as offset:length
+int parseRangeNumber(const char *text, const char **end, unsigned long long *value);
+
+//Functions to write and read the container header, which holds the dictionary ID if a dictionary is used
+size_t writeContainerHeader(unsigned char *header, size_t blockSize, const BlockFormat *format);
+size_t containerHeaderLength(const unsigned char *header);
+int readContainerHeader(const unsigned char *header, const Dictionary *dictionary, size_t *blockSize, BlockFormat *format);
+
+//Functions to write and read the frame header in front of every block, compact in files with a dictionary
+size_t writeFrameHeader(unsigned char *frame, size_t rawLength, size_t compressedLength, const BlockFormat *format);
+size_t readFrameHeader(const unsigned char *data, size_t length, const BlockFormat *format, size_t *rawLength, size_t *compressedLength);
+
+//Functions to train, save, load and free dictionaries of pretrained code tables
+int trainDictionary(const char **inputNames, int numberInputs, int maxCodeLength, Dictionary *dictionary);
+int finishDictionary(Dictionary *dictionary);
+int saveDictionary(const Dictionary *dictionary, FILE *file);
+int loadDictionary(FILE *file, Dictionary *dictionary);
+void freeDictionary(Dictionary *dictionary);
+
+//Functions to time the benchmark and measure its peak memory use
+double currentSeconds(void);
+long long peakMemoryKilobytes(void);
+
+//Function to fill a buffer with a synthetic benchmark input of the given entropy profile
+void generateSynthetic(int profile, unsigned char *data, size_t length);
+
+//Functions to (de-)compress a buffer in memory with the streaming API
+int compressBuffer(const unsigned char *data, size_t length, const CodecOptions *options, ByteBuffer *output);
+int decompressBuffer(const unsigned char *data, size_t length, const CodecOptions *options, ByteBuffer *output);
+
+//Function to decode the blocks of a compressed buffer one after the other, for the decode-only timing
+int decodeBlocksOnly(const unsigned char *data, size_t length, const CodecOptions *options, ByteBuffer *block, unsigned long long *decodedTotal);
+
+//Function to time counting the frequencies against the single count loop
+double timeHistogram(const unsigned char *data, size_t length, size_t blockSize, int simple);
+
+//Function to benchmark one input and print its results as JSON
+int benchmarkBuffer(const char *name, const unsigned char *data, size_t length, const CodecOptions *options, int first);
+
+//Function to print a string as a JSON string
+void printJsonString(FILE *file, const char *text);
+
+//Functions to clear, add up and print the statistics of (de-)compression as JSON
+void initStats(CodecStats *stats);
+void addStats(CodecStats *total, const CodecStats *stats);
+void printStats(FILE *file, const CodecStats *stats);
+
+//Functions to count the time of a phase and the data of a block in the statistics, only compiled with HUFFMAN_STATS
+void lapStats(CodecStats *stats, int phase, double *timer, unsigned long long bytes, unsigned long long symbols);
+void finishStats(CodecStats *stats, double start);
+void recordEncodedBlock(CodecStats *stats, const BlockFormat *format, const BlockPlan *plan, size_t length, size_t compressedLength);
+void recordDecodedBlock(CodecStats *stats, const BlockFormat *format, int mode, size_t rawLength, size_t compressedLength);
+
+//Function to benchmark inputs, or the example files and synthetic inputs, and print the results as JSON
+int runBenchmark(const char **inputNames, int numberInputs, const CodecOptions *options, size_t syntheticSize);
+
+//Function to code the blocks of a pool on worker threads and write the results in order
+int runBlockPool(BlockPool *pool, FILE *output, unsigned long long *blockOffsets, unsigned long long *position, int numberThreads);
+
+//Function run by every worker thread of a block pool
+void *blockWorker(void *argument);
+
+//Function to find a block of a pool decompressing a file and its lengths
+const unsigned char *poolBlock(const BlockPool *pool, size_t b, size_t *rawLength, size_t *compressedLength);
+
+//Function to get the number of processor cores
+int numberOfCores(void);
+
+//Functions wrapping the threads, mutexes and condition variables of the operating system
+int startThread(Thread *thread, void *(*function)(void *), void *argument);
+void joinThread(Thread thread);
+void initMutex(Mutex *mutex);
+void destroyMutex(Mutex *mutex);
+void lockMutex(Mutex *mutex);
+void unlockMutex(Mutex *mutex);
+void initCondition(Condition *condition);
+void destroyCondition(Condition *condition);
+void waitCondition(Condition *condition, Mutex *mutex);
+void broadcastCondition(Condition *condition);
+
+//Functions for arenas holding the tables of one block
+void initArena(Arena *arena, size_t capacity);
+void *arenaAlloc(Arena *arena, size_t size);
+void resetArena(Arena *arena);
+void freeArena(Arena *arena);
+
+//Functions for growable byte buffers
+void initByteBuffer(ByteBuffer *buffer);
+int reserveByteBuffer(ByteBuffer *buffer, size_t extra);
+int appendByteBuffer(ByteBuffer *buffer, const void *data, size_t length);
+void freeByteBuffer(ByteBuffer *buffer);
+
+//Functions to store and load little-endian integers of the container format
+void putU32(unsigned char *destination, unsigned int value);
+unsigned int getU32(const unsigned char *source);
+void putU64(unsigned char *destination, unsigned long long value);
+unsigned long long getU64(const unsigned char *source);
 
 #endif
\ No newline at end of file
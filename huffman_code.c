@@ -8,127 +8,2995 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <errno.h> //used to find numbers too large for the range
+#ifdef HUFFMAN_STATS
+#include <math.h> //used for the entropy in the statistics, link with -lm
+#endif
+#ifndef _WIN32 //memory mapping is only used on POSIX systems, Windows reads the input in large chunks
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h> //used to get the number of processor cores
+#include <time.h> //used to time the benchmark
+#include <sys/resource.h> //used to get the peak memory use for the benchmark
+#include <dirent.h> //used to list the files of a directory for the batch mode
+#else
+#include <io.h> //used to switch stdin and stdout to binary mode
+#include <fcntl.h>
+#include <windows.h> //psapi.h needs its types
+#include <psapi.h> //used to get the peak memory use for the benchmark
+#ifdef _MSC_VER
+#pragma comment(lib, "psapi.lib") //GetProcessMemoryInfo is in psapi.lib on older Windows versions
+#endif
+#endif
 
 #include "types.h" //contains structure definitions for Frequency, Node and Code
 #include "functions.h" //contains function declarations
 
-#define INT_MAX 2147483647 //Used for initialisation in findMinNode function, max integer value
 #define ASCII_SIZE 256 //Number of ASCII characters (ASCII Extended)
+#define DEFAULT_CODE_LENGTH_LIMIT 11 //Default longest code, a decode table of 2^11 entries fits in the L1 cache
+#define MIN_CODE_LENGTH_LIMIT 8 //Shortest possible limit, 2^8 codes are needed for all 256 symbols
+#define FORMAT_VERSION 7 //Version of the compressed file format, stored in the header after the magic bytes
+#define HEADER_MAGIC "HF" //Magic bytes at the start of every compressed file
+#define CONTAINER_HEADER_SIZE 8 //Magic bytes, version, flags and block size at the start of a compressed file
+#define HEADER_FLAG_DICTIONARY 1 //Flag of the container header: blocks may be coded with a dictionary, its ID follows the header, frames are compact
+#define HEADER_FLAG_INTERLEAVED 2 //Flag of the container header: every block is split into INTERLEAVED_STREAMS bit streams
+#define INTERLEAVED_STREAMS 4 //Number of bit streams of an interleaved block, decoded side by side
+#define JUMP_TABLE_SIZE (4 * (INTERLEAVED_STREAMS - 1)) //Sizes of all bit streams of an interleaved block but the last one
+#define PAIR_TABLE_BITS 11 //Longest code the pair table of interleaved blocks is built for, its 2^11 slots of 4 bytes fit in the L1 cache
+#define PAIR_LOOKUPS (57 / PAIR_TABLE_BITS) //Lookups of the pair table per 64 bit load, a constant so the compiler can unroll them
+#define PAIR_MIN_SYMBOLS 16 //Interleaved blocks use the pair table from 16 characters per slot, smaller ones do not make up for building it
+#define DICTIONARY_ID_SIZE 4 //Size of the dictionary ID following the container header
+#define DICTIONARY_MAGIC "HD" //Magic bytes at the start of every dictionary file
+#define DICTIONARY_VERSION 2 //Version of the dictionary file format
+#define DICTIONARY_HEADER_SIZE 8 //Magic bytes, version, reserved byte and ID at the start of a dictionary file
+#define FRAME_HEADER_SIZE 8 //Uncompressed length and compressed length in front of every block
+#define COMPACT_FRAME_HEADER_SIZE 10 //Largest frame header of a file with a dictionary: both lengths as varints of up to 5 bytes
+#define BLOCK_TABLE 0 //Block mode: Huffman coded with the code table stored in the block
+#define BLOCK_REPEAT 1 //Block mode: Huffman coded with the code table of an earlier block, whose index follows the mode
+#define BLOCK_RAW 2 //Block mode: stored as it is, used when coding would not make the block smaller
+#define BLOCK_RLE 3 //Block mode: a single repeated character, stored once
+#define BLOCK_DICTIONARY 4 //Block mode: Huffman coded with the code table of the dictionary, which the block does not store
+#define BLOCK_OWNER_SIZE 4 //Size of the index of the block whose code table a BLOCK_REPEAT block reuses
+#define FOOTER_SIZE 16 //Number of blocks and position of the block index at the end of a compressed file
+#define DEFAULT_BLOCK_SIZE (1 << 20) //Number of input bytes coded independently in one block
+#define MAX_BLOCK_SIZE (1 << 30) //Largest block size, block lengths are stored in 32 bits
+#define MAX_THREADS 256 //Largest number of worker threads
+#define BLOCKS_PER_THREAD 4 //Number of blocks per worker that can be in flight before the oldest one is written
+#define DECODER_HEADER 0 //Streaming decoder expects the container header
+#define DECODER_FRAME_HEADER 1 //Streaming decoder expects a frame header
+#define DECODER_FRAME 2 //Streaming decoder expects the compressed block of a frame
+#define DECODER_TRAILER 3 //Streaming decoder has seen the end frame, index and footer follow unless the file has a dictionary
+#define LENGTH_BITS 4 //Number of bits used to store one code length (minus 1) in the header, codes are at most MAX_CODE_LENGTH bits
+#define MAX_TABLE_SIZE (1 + 2 * 128 + (NUMBER_SYMBOLS * LENGTH_BITS + 7) / 8) //Largest code table of a block: 128 ranges and every symbol present
+#define IO_BUFFER_SIZE 65536 //Size of the buffers used to read and write files in large chunks
+#define HISTOGRAM_LANES 8 //Number of separate count tables used by countFrequencies, one per byte of a 64 bit load
+#define HISTOGRAM_MIN_LENGTH (HISTOGRAM_LANES * ASCII_SIZE * 4) //Shortest input counted with the count tables, 8 KB, shorter ones do not make up for clearing and adding them up
+#define SPOOL_INITIAL_SIZE (1 << 20) //Initial size of the buffer that collects input from pipes, doubled when full
+#ifdef _WIN32
+#define PATH_SEPARATORS "/\\" //Characters ending the directory part of a file name
+#else
+#define PATH_SEPARATORS "/"
+#endif
+#define BENCH_RUNS 3 //Number of times the benchmark codes every input, the fastest run is reported
+#define DEFAULT_BENCH_SIZE (16 << 20) //Size of the synthetic benchmark inputs
+#define ARENA_ALIGNMENT 16 //Alignment of every allocation from an arena
+#define ARENA_SIZE (2 * ASCII_SIZE * sizeof(Frequency) + (2 * NUMBER_SYMBOLS - 1) * sizeof(Node) + 2 * NUMBER_SYMBOLS * sizeof(Code) \
+                    + ((size_t)1 << MAX_CODE_LENGTH) * sizeof(DecodeEntry) + 8 * ARENA_ALIGNMENT) //Largest memory one block needs: frequencies, tree, own and reused code table, decode table
+#define PHASE_INPUT 0 //Phase of the statistics: loading the input, or reading the frames of a range
+#define PHASE_HISTOGRAM 1 //Phase of the statistics: counting the characters of a block
+#define PHASE_TREE 2 //Phase of the statistics: building the Huffman tree
+#define PHASE_CODE_TABLE 3 //Phase of the statistics: building the canonical code table with limited code lengths
+#define PHASE_CHOOSE_MODE 4 //Phase of the statistics: choosing the block mode
+#define PHASE_WAIT 5 //Phase of the statistics: worker threads waiting for the mode of the previous block
+#define PHASE_WRITE_TABLE 6 //Phase of the statistics: writing the block mode and the code table
+#define PHASE_ENCODE 7 //Phase of the statistics: encoding the block, or copying it for raw and RLE blocks
+#define PHASE_READ_TABLE 8 //Phase of the statistics: reading the code table and building the decode table
+#define PHASE_DECODE 9 //Phase of the statistics: decoding the block, or copying it for raw and RLE blocks
+#define PHASE_WRITE_OUTPUT 10 //Phase of the statistics: writing the output
+
+#ifdef HUFFMAN_STATS //the statistics are only compiled in if asked for, otherwise these macros leave no code behind
+#define STATS_TIMER(stats, timer) double timer = (stats) != NULL ? currentSeconds() : 0.0 //start timing the phases of a function
+#define STATS_LAP(stats, phase, timer, bytes, symbols) lapStats(stats, phase, &timer, bytes, symbols) //count the time since the last lap for a phase
+#define STATS_RESTART(stats, timer) timer = (stats) != NULL ? currentSeconds() : 0.0 //start a lap again, leaving out the time since the last one
+#define STATS_CALL(call) call //call one of the other statistics functions
+#else
+#define STATS_TIMER(stats, timer)
+#define STATS_LAP(stats, phase, timer, bytes, symbols) ((void)(stats), (void)(bytes), (void)(symbols)) //no side effects, the compiler drops them
+#define STATS_RESTART(stats, timer) ((void)(stats))
+#define STATS_CALL(call)
+#endif
 
 /*Main function---------------------------------------------------------------------------------*/
-int main(){
+#ifndef HUFFMAN_NO_MAIN //define HUFFMAN_NO_MAIN to compile this file as a library into another program
+int main(int argc, char **argv){
+    if (argc > 1) { //arguments given: run without asking anything, for scripts and pipelines
+        return commandLineMode(argc, argv);
+    }
+    return interactiveMode(); //no arguments: ask for the file name like before
+}
+#endif
+
+/*run the interactive mode asking for a file name*/
+int interactiveMode(void){
     printf("-----------------------------Huffman (de-)compression-----------------------------");
     printf("\n");
     char filename[101];  //filename can be up to 100 characters long
-    FILE *input, *output; //create pointers to input and output files
+    FILE *input = NULL, *output = NULL; //create pointers to input and output files
+    int result = 1; //exit code, 0 on success
+
+    printf("Only .txt files are supported for compression and .bin files for decompression. Please ensure that the entered file path is no longer than 100 characters.\n"); //explain to user what to do
+    printf("The output file will be named output.bin for compression and output.txt for decompression. It will appear in the same directory as the input file.\n"); //explain to user what to do
+    printf("Type the name of the file to process:");
+    if (scanf("%100s",filename) != 1){ //get filename (or path) from user, at most 100 characters
+        printf("No filename given. Please try again.");
+        return 1; //exit the program if no filename was read
+    }
+    int compress = getFileType(filename); //check if file is .txt or .bin, returns 1 for .txt, 2 for .bin, 0 for unknown file type
+
+    CodecOptions options;
+    defaultCodecOptions(&options); //1 MB blocks, one worker thread per core
+    options.verbose = 1; //the interactive mode prints progress and statistics
+
+    switch (compress) { //switch between compression and decompression dependent on file type
+        case 1: //if .txt file -> compress
+            input = fopen(filename, "r"); //open input file in read mode
+            output = fopen("output.bin", "wb"); //open output file in binary write mode
+            if (input == NULL || output == NULL) { //check that both files could be opened
+                printf("Could not open the input or the output file.\n");
+                break;
+            }
+            result = compressFile(input, output, &options); //call compress function
+            printf("\n-----------------------------Compression complete-----------------------------\n");
+            break; //break out of switch statement
+        case 2: //if .bin file -> decompress
+            input = fopen(filename, "rb"); //open input file in binary read mode
+            output = fopen("output.txt", "w"); //open output file in write mode
+            if (input == NULL || output == NULL) { //check that both files could be opened
+                printf("Could not open the input or the output file.\n");
+                break;
+            }
+            result = decompressFile(input, output, &options); //call decompress function
+            printf("\n-----------------------------Decompression complete-----------------------------\n");
+            break;
+        default: //if unknown file type -> error message
+            printf("Invalid input. Please use either a .txt or a .bin file\n");
+            break; //break out of switch statement
+    }
+
+    if (input != NULL) {
+        fclose(input); //close input file
+    }
+    if (output != NULL) {
+        fclose(output); //close output file
+    }
+
+    return result; //return 0 to indicate successful execution
+}
+
+/*print the command line usage*/
+void printUsage(FILE *file){
+    fprintf(file, "Usage: huffman (-c | -d) [-o output] [-b block size] [-t threads] [-l bits] [-i] [-r offset:length] [-D dictionary] [-v] [--stats] [input]\n");
+    fprintf(file, "  -c            compress\n");
+    fprintf(file, "  -d            decompress\n");
+    fprintf(file, "  -o output     output file, - for stdout (default)\n");
+    fprintf(file, "  -b size       block size in bytes for compression (default %d)\n", DEFAULT_BLOCK_SIZE);
+    fprintf(file, "  -t threads    number of worker threads (default: one per core)\n");
+    fprintf(file, "  -l bits       longest code, %d to %d bits (default %d)\n", MIN_CODE_LENGTH_LIMIT, MAX_CODE_LENGTH, DEFAULT_CODE_LENGTH_LIMIT);
+    fprintf(file, "  -i            split every block into %d interleaved bit streams, which decode faster\n", INTERLEAVED_STREAMS);
+    fprintf(file, "  -r offset:length decompress only length bytes from offset of the uncompressed data, reads only the blocks holding them\n");
+    fprintf(file, "  -D dictionary code blocks with a dictionary made by --train where that is smaller, also needed to decompress\n");
+    fprintf(file, "  -v            print progress and statistics to stderr\n");
+    fprintf(file, "  --stats       print the time of every phase, block modes, code length and entropy to stderr as JSON, needs a build with -DHUFFMAN_STATS\n");
+    fprintf(file, "  input         input file, - for stdin (default)\n");
+    fprintf(file, "Dictionary: huffman --train -o dictionary [-l bits] sample...\n");
+    fprintf(file, "  Trains a code table on sample files, small inputs coded with it need no code table of their own.\n");
+    fprintf(file, "Benchmark: huffman --bench [-b block size] [-l bits] [-i] [-D dictionary] [-s size] [input...]\n");
+    fprintf(file, "  Codes every input %d times, checks the round trip and prints the results as JSON.\n", BENCH_RUNS);
+    fprintf(file, "  Without inputs, the example files and synthetic inputs of -s bytes (default %d) are used.\n", DEFAULT_BENCH_SIZE);
+    fprintf(file, "Batch: huffman --batch [-c | -d] [-O directory] [-L list] [-t threads] [options above] [input...]\n");
+    fprintf(file, "  Codes many files on worker threads, one file per thread at a time, and prints the throughput at the end.\n");
+    fprintf(file, "  Inputs are files or directories (their .txt files with -c, .bin files with -d), -L adds one file per line of a list, - for stdin.\n");
+    fprintf(file, "  name.txt is compressed to name.bin and name.bin decompressed to name.txt, next to the input or in the directory given with -O.\n");
+    fprintf(file, "Without -c or -d, .txt inputs are compressed and .bin inputs are decompressed.\n");
+    fprintf(file, "Without any argument, the program asks for a file name.\n");
+}
+
+/*run the command line mode*/
+int commandLineMode(int argc, char **argv){
+    int mode = 0; //1 to compress, 2 to decompress, same values as getFileType, 3 to benchmark, 4 to train a dictionary, 5 to decompress a range
+    unsigned long long rangeOffset = 0, rangeLength = 0; //range of the uncompressed data to decompress with -r
+    int range = 0; //1 if a range was given
+    const char *outputName = "-";
+    const char **inputNames = malloc(argc * sizeof(char *)); //every input given, only the benchmark and the training take more than one
+    int numberInputs = 0;
+    size_t benchSize = DEFAULT_BENCH_SIZE; //size of the synthetic benchmark inputs
+    const char *dictionaryName = NULL;
+    int printStatistics = 0; //1 to print the statistics with --stats
+    int batch = 0; //1 to code many files with --batch
+    const char *listName = NULL; //file with one input name per line for the batch mode
+    const char *outputDirectory = NULL; //directory receiving the outputs of the batch mode
+    CodecOptions options;
+    defaultCodecOptions(&options);
+    if (inputNames == NULL) {
+        return 1; //return 1 on error
+    }
+
+    for (int i = 1; i < argc; i++) { //read the arguments
+        if (strcmp(argv[i], "-c") == 0) {
+            mode = 1;
+        }
+        else if (strcmp(argv[i], "-d") == 0) {
+            mode = 2;
+        }
+        else if (strcmp(argv[i], "--bench") == 0) {
+            mode = 3;
+        }
+        else if (strcmp(argv[i], "--train") == 0) {
+            mode = 4;
+        }
+        else if (strcmp(argv[i], "-v") == 0) {
+            options.verbose = 1;
+        }
+        else if (strcmp(argv[i], "--stats") == 0) {
+            printStatistics = 1;
+        }
+        else if (strcmp(argv[i], "--batch") == 0) {
+            batch = 1;
+        }
+        else if (strcmp(argv[i], "-i") == 0) {
+            options.numberStreams = INTERLEAVED_STREAMS;
+        }
+        else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            printUsage(stdout);
+            free(inputNames);
+            return 0;
+        }
+        else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "-l") == 0 || strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "-D") == 0 || strcmp(argv[i], "-r") == 0
+                  || strcmp(argv[i], "-L") == 0 || strcmp(argv[i], "-O") == 0) && i + 1 < argc) { //options with a value
+            if (argv[i][1] == 'o') {
+                outputName = argv[i + 1];
+            }
+            else if (argv[i][1] == 'b') {
+                options.blockSize = (size_t)strtoull(argv[i + 1], NULL, 10);
+            }
+            else if (argv[i][1] == 's') {
+                benchSize = (size_t)strtoull(argv[i + 1], NULL, 10);
+            }
+            else if (argv[i][1] == 'D') {
+                dictionaryName = argv[i + 1];
+            }
+            else if (argv[i][1] == 'L') {
+                listName = argv[i + 1];
+            }
+            else if (argv[i][1] == 'O') {
+                outputDirectory = argv[i + 1];
+            }
+            else if (argv[i][1] == 'r') {
+                const char *separator, *end;
+                if (parseRangeNumber(argv[i + 1], &separator, &rangeOffset) != 0 || *separator != ':'
+                    || parseRangeNumber(separator + 1, &end, &rangeLength) != 0 || *end != '\0') { //both numbers have to be there, with nothing around them
+                    fprintf(stderr, "Give the range as offset:length\n");
+                    free(inputNames);
+                    return 1;
+                }
+                range = 1;
+            }
+            else if (argv[i][1] == 'l') {
+                options.maxCodeLength = atoi(argv[i + 1]);
+            }
+            else {
+                options.numberThreads = atoi(argv[i + 1]);
+            }
+            i++; //skip the value
+        }
+        else if (argv[i][0] != '-' || strcmp(argv[i], "-") == 0) { //input file
+            inputNames[numberInputs++] = argv[i];
+        }
+        else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            printUsage(stderr);
+            free(inputNames);
+            return 1;
+        }
+    }
+    if (range) { //a range can only be decompressed
+        if (mode != 0 && mode != 2) {
+            fprintf(stderr, "-r only works when decompressing\n");
+            free(inputNames);
+            return 1;
+        }
+        mode = 5;
+    }
+    if (batch && (mode > 2 || strcmp(outputName, "-") != 0)) { //every file gets its own output
+        fprintf(stderr, "--batch only works when compressing or decompressing, use -O for the output directory\n");
+        free(inputNames);
+        return 1;
+    }
+    if (!batch && (listName != NULL || outputDirectory != NULL)) {
+        fprintf(stderr, "-L and -O only work with --batch\n");
+        free(inputNames);
+        return 1;
+    }
+    CodecStats stats;
+    if (printStatistics) { //the statistics cover one (de-)compression
+#ifndef HUFFMAN_STATS
+        fprintf(stderr, "--stats needs a build with -DHUFFMAN_STATS\n");
+        free(inputNames);
+        return 1;
+#endif
+        if (mode == 3 || mode == 4) {
+            fprintf(stderr, "--stats only works when compressing or decompressing\n");
+            free(inputNames);
+            return 1;
+        }
+        initStats(&stats);
+        options.stats = &stats;
+    }
+    if (mode == 4) { //train a dictionary on the inputs
+        int result = trainDictionaryFiles(inputNames, numberInputs, outputName, &options);
+        free(inputNames);
+        return result;
+    }
+    Dictionary dictionary;
+    if (dictionaryName != NULL) {
+        FILE *dictionaryFile = fopen(dictionaryName, "rb");
+        if (dictionaryFile == NULL || loadDictionary(dictionaryFile, &dictionary) != 0) {
+            if (dictionaryFile == NULL) {
+                fprintf(stderr, "Could not open %s\n", dictionaryName);
+            }
+            else {
+                fclose(dictionaryFile);
+                freeDictionary(&dictionary);
+            }
+            free(inputNames);
+            return 1;
+        }
+        fclose(dictionaryFile);
+        options.dictionary = &dictionary;
+    }
+    int result = 1;
+    if (mode == 3) { //the benchmark reads its own inputs and prints to stdout
+        result = runBenchmark(inputNames, numberInputs, &options, benchSize);
+    }
+    else if (batch) { //every file is coded on one worker thread, stdout only gets the throughput
+        result = runBatch(mode, inputNames, numberInputs, listName, outputDirectory, &options);
+    }
+    else if (numberInputs > 1) {
+        fprintf(stderr, "Only one input can be (de-)compressed at once\n");
+    }
+    else {
+        result = codeFiles(mode, numberInputs > 0 ? inputNames[0] : "-", outputName, rangeOffset, rangeLength, &options); //stdin if no input is given
+    }
+    if (result == 0 && options.stats != NULL) { //stderr, stdout may carry the data
+        printStats(stderr, options.stats);
+    }
+    if (options.dictionary != NULL) {
+        freeDictionary(&dictionary);
+    }
+    free(inputNames);
+    return result;
+}
+
+/*train a dictionary on sample files and write it to a file*/
+int trainDictionaryFiles(const char **inputNames, int numberInputs, const char *outputName, const CodecOptions *options) {
+    if (numberInputs == 0 || strcmp(outputName, "-") == 0) {
+        fprintf(stderr, "Give the dictionary file with -o and at least one sample file\n");
+        return 1; //return 1 on error
+    }
+    if (checkCodecOptions(options) != 0) {
+        return 1;
+    }
+    Dictionary dictionary;
+    int result = trainDictionary(inputNames, numberInputs, options->maxCodeLength, &dictionary);
+    FILE *output = result == 0 ? fopen(outputName, "wb") : NULL;
+    if (result == 0 && output == NULL) {
+        fprintf(stderr, "Could not open %s\n", outputName);
+        result = 1;
+    }
+    if (output != NULL) {
+        result = saveDictionary(&dictionary, output);
+        if (fclose(output) != 0) {
+            result = 1;
+        }
+    }
+    if (result == 0 && options->verbose) {
+        fprintf(stderr, "Dictionary %08x written to %s\n", dictionary.id, outputName);
+    }
+    freeDictionary(&dictionary);
+    return result;
+}
+
+/*compress (mode 1), decompress (mode 2) or decompress a range (mode 5) of one input to one output*/
+int codeFiles(int mode, const char *inputName, const char *outputName, unsigned long long rangeOffset, unsigned long long rangeLength, const CodecOptions *options) {
+    if (mode == 0) { //no -c or -d, decide from the name of the input like the interactive mode
+        mode = getFileType((char *)inputName);
+    }
+    if (mode == 0) {
+        fprintf(stderr, "Use -c to compress or -d to decompress\n");
+        printUsage(stderr);
+        return 1;
+    }
+
+    int inputIsStream = strcmp(inputName, "-") == 0; //stdin is read with the streaming API
+    FILE *input = inputIsStream ? stdin : fopen(inputName, "rb");
+    if (input == NULL) { //checked before the output is opened, so a missing input does not truncate an existing output
+        fprintf(stderr, "Could not open %s\n", inputName);
+        return 1;
+    }
+    FILE *output = strcmp(outputName, "-") == 0 ? stdout : fopen(outputName, "wb");
+    if (output == NULL) {
+        fprintf(stderr, "Could not open %s\n", outputName);
+        if (input != stdin) {
+            fclose(input);
+        }
+        return 1;
+    }
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY); //stdin and stdout carry binary data, so no newline translation
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    //Files are mapped and coded on all worker threads. Streams go through the streaming API, which needs only a few blocks of memory.
+    int result;
+    if (mode == 5) { //only the blocks of the range are read, so the input has to be a file
+        ByteBuffer range;
+        initByteBuffer(&range);
+        result = decompressRange(input, rangeOffset, rangeLength, options, &range);
+        if (result == 0) {
+            fwrite(range.data, 1, range.length, output);
+        }
+        freeByteBuffer(&range);
+    }
+    else if (mode == 1) {
+        result = (inputIsStream || options->numberThreads <= 1) ? compressStream(input, output, options) : compressFile(input, output, options);
+    }
+    else {
+        result = (inputIsStream || options->numberThreads <= 1) ? decompressStream(input, output, options) : decompressFile(input, output, options);
+    }
+
+    if (fflush(output) != 0 || ferror(output)) { //report write errors such as a full disk or a closed pipe
+        fprintf(stderr, "Error writing %s\n", outputName);
+        result = 1;
+    }
+    if (input != stdin) {
+        fclose(input);
+    }
+    if (output != stdout) {
+        if (fclose(output) != 0) {
+            result = 1;
+        }
+        if (result != 0) { //do not leave a partial output behind, like the batch mode
+            remove(outputName);
+        }
+    }
+    return result;
+}
+
+/*read one number of a range given on the command line, end is set to the first character after its digits*/
+int parseRangeNumber(const char *text, const char **end, unsigned long long *value) {
+    if (*text < '0' || *text > '9') { //strtoull would skip spaces, accept a sign and wrap negative numbers around, and reads an empty field as 0
+        return 1; //return 1 on error
+    }
+    char *stop;
+    errno = 0;
+    *value = strtoull(text, &stop, 10);
+    *end = stop;
+    return errno == ERANGE; //return 0 on success, 1 if the number does not fit
+}
+
+/*Compress and Decompress function definitions--------------------------------------------------------------------------*/
+/*fill codec options with the default block size and one thread per core*/
+void defaultCodecOptions(CodecOptions *options) {
+    options->blockSize = DEFAULT_BLOCK_SIZE;
+    options->numberThreads = numberOfCores();
+    options->maxCodeLength = DEFAULT_CODE_LENGTH_LIMIT;
+    options->dictionary = NULL;
+    options->numberStreams = 1;
+    options->verbose = 0;
+    options->stats = NULL;
+}
+
+/*check the options of the compressor*/
+int checkCodecOptions(const CodecOptions *options) {
+    if (options->blockSize == 0 || options->blockSize > MAX_BLOCK_SIZE) { //block lengths have to fit into 32 bits
+        fprintf(stderr, "Block size has to be between 1 and %d bytes\n", MAX_BLOCK_SIZE);
+        return 1; //return 1 on error
+    }
+    if (options->maxCodeLength < MIN_CODE_LENGTH_LIMIT || options->maxCodeLength > MAX_CODE_LENGTH) {
+        fprintf(stderr, "Code length limit has to be between %d and %d bits\n", MIN_CODE_LENGTH_LIMIT, MAX_CODE_LENGTH);
+        return 1;
+    }
+    if (options->numberStreams != 1 && options->numberStreams != INTERLEAVED_STREAMS) {
+        fprintf(stderr, "Blocks have either 1 or %d bit streams\n", INTERLEAVED_STREAMS);
+        return 1;
+    }
+    return 0; //return 0 on success
+}
+
+/*function to compress the input .txt file and give out a binary output file*/
+int compressFile(FILE *input, FILE *output, const CodecOptions *options){
+    //File: header (magic bytes, version, flags, block size), block frames (uncompressed length, compressed length, block),
+    //an empty frame marking the end, the index of block frame positions and the footer (number of blocks, position of the index)
+    if (options->verbose) {
+        fprintf(stderr, "Compressing file\n"); //progress goes to stderr, stdout may carry the compressed data
+    }
+
+    if (checkCodecOptions(options) != 0) {
+        return 1; //return 1 on error
+    }
+
+    STATS_TIMER(options->stats, start);
+    STATS_TIMER(options->stats, timer);
+    InputData inputData; //the input is loaded once, the frequency count and the encoder both read the same memory
+    if (loadInput(input, &inputData) != 0) {
+        return 1;
+    }
+    STATS_LAP(options->stats, PHASE_INPUT, timer, inputData.length, 0);
+
+    unsigned char header[CONTAINER_HEADER_SIZE + DICTIONARY_ID_SIZE];
+    BlockFormat format = {options->dictionary, options->numberStreams};
+    size_t headerLength = writeContainerHeader(header, options->blockSize, &format);
+    fwrite(header, sizeof(unsigned char), headerLength, output); //write the header of the file
+
+    BlockPool pool; //every block is compressed on its own, so blocks can be compressed in parallel
+    pool.compress = 1;
+    pool.input = inputData.data;
+    pool.inputLength = inputData.length;
+    pool.blockSize = options->blockSize;
+    pool.blockCount = (inputData.length + options->blockSize - 1) / options->blockSize;
+    pool.frameOffsets = NULL;
+    pool.maxCodeLength = options->maxCodeLength;
+    pool.format = format;
+    pool.stats = options->stats;
+
+    unsigned long long *blockOffsets = malloc((pool.blockCount + 1) * sizeof(unsigned long long)); //position of every block frame in the output, +1 so an empty file still gets memory
+    if (blockOffsets == NULL) {
+        fprintf(stderr, "Error allocating memory for the block index\n");
+        freeInput(&inputData);
+        return 1;
+    }
+    unsigned long long position = headerLength; //number of bytes written to the output, the output may be a pipe so ftell cannot be used
+    if (runBlockPool(&pool, output, blockOffsets, &position, options->numberThreads) != 0) { //compress the blocks and write their frames in order
+        free(blockOffsets);
+        freeInput(&inputData);
+        return 1;
+    }
+
+    unsigned char frame[COMPACT_FRAME_HEADER_SIZE]; //empty frame marking the end of the blocks for decoders reading front to back
+    size_t frameLength = writeFrameHeader(frame, 0, 0, &format);
+    fwrite(frame, sizeof(unsigned char), frameLength, output);
+    position += frameLength;
+
+    if (format.dictionary == NULL) { //files with a dictionary hold small inputs, which are read whole, so they have no index
+        unsigned long long indexOffset = position; //the index of block positions follows the end frame
+        for (size_t block = 0; block < pool.blockCount; block++) {
+            unsigned char entry[8];
+            putU64(entry, blockOffsets[block]);
+            fwrite(entry, sizeof(unsigned char), 8, output);
+        }
+        unsigned char footer[FOOTER_SIZE]; //the footer has a fixed size, so readers find the index from the end of the file
+        putU64(footer, pool.blockCount);
+        putU64(footer + 8, indexOffset);
+        fwrite(footer, sizeof(unsigned char), FOOTER_SIZE, output);
+        position += 8 * pool.blockCount + FOOTER_SIZE;
+    }
+
+    free(blockOffsets);
+
+    if (options->verbose) {
+        summarizeCompression(inputData.length, position); //print compression statistics to terminal: original bits, compressed bits, compression ratio, saved memory
+    }
+    freeInput(&inputData); //unmap or free the input
+    STATS_CALL(finishStats(options->stats, start));
+
+    return 0; //return 0 on success
+}
+
+/*function to decompress the input .bin file to a .txt file*/
+int decompressFile(FILE *input, FILE *output, const CodecOptions *options) {
+    if (options->verbose) {
+        fprintf(stderr, "Decompressing file\n");
+    }
+
+    STATS_TIMER(options->stats, start);
+    STATS_TIMER(options->stats, timer);
+    InputData inputData; //the compressed file is loaded once, the blocks are decoded straight from it
+    if (loadInput(input, &inputData) != 0) {
+        return 1; //return 1 on error
+    }
+    STATS_LAP(options->stats, PHASE_INPUT, timer, inputData.length, 0);
+    const unsigned char *data = inputData.data;
+
+    BlockPool pool; //every block was compressed on its own, so blocks can be decompressed in parallel
+    if (inputData.length < CONTAINER_HEADER_SIZE || inputData.length < containerHeaderLength(data)
+        || readContainerHeader(data, options->dictionary, &pool.blockSize, &pool.format) != 0) { //check that the file was written by this version
+        if (inputData.length < CONTAINER_HEADER_SIZE || inputData.length < containerHeaderLength(data)) {
+            fprintf(stderr, "Unsupported file format, the file was not compressed by this version of the program\n");
+        }
+        freeInput(&inputData);
+        return 1;
+    }
+    pool.compress = 0;
+    pool.input = data;
+    pool.inputLength = inputData.length;
+    pool.blockCount = 0;
+
+    //walk the frames once to find the blocks, this only reads the frame headers
+    size_t capacity = 64; //number of frame positions frameOffsets can hold, doubled when full
+    unsigned long long *frameOffsets = malloc(capacity * sizeof(unsigned long long));
+    size_t position = containerHeaderLength(data);
+    int valid = frameOffsets != NULL;
+    while (valid) {
+        size_t rawLength, compressedLength;
+        size_t frameLength = readFrameHeader(data + position, inputData.length - position, &pool.format, &rawLength, &compressedLength);
+        if (frameLength == 0) { //the end frame is missing
+            valid = 0;
+            break;
+        }
+        if (rawLength == 0) { //empty frame marks the end of the blocks
+            break;
+        }
+        if (rawLength > pool.blockSize || compressedLength > inputData.length - position - frameLength) { //frame does not fit the file
+            valid = 0;
+            break;
+        }
+        if (pool.blockCount == capacity) { //make room for more frame positions
+            unsigned long long *bigger = realloc(frameOffsets, 2 * capacity * sizeof(unsigned long long));
+            if (bigger == NULL) {
+                valid = 0;
+                break;
+            }
+            frameOffsets = bigger;
+            capacity *= 2;
+        }
+        frameOffsets[pool.blockCount++] = position;
+        position += frameLength + compressedLength; //skip to the next frame
+    }
+    if (!valid) {
+        fprintf(stderr, "Compressed file is corrupted\n");
+        free(frameOffsets);
+        freeInput(&inputData);
+        return 1;
+    }
+    pool.frameOffsets = frameOffsets;
+    pool.maxCodeLength = MAX_CODE_LENGTH; //blocks carry their own code lengths
+    pool.stats = options->stats;
+
+    unsigned long long written = 0; //number of decompressed bytes written
+    int result = runBlockPool(&pool, output, NULL, &written, options->numberThreads); //decompress the blocks and write them in order
+
+    free(frameOffsets);
+    freeInput(&inputData);
+    STATS_CALL(finishStats(options->stats, start));
+    return result; //return 0 on success
+}
+
+/*decompress length bytes starting at offset of the uncompressed data, only the blocks holding them are read and decoded*/
+int decompressRange(FILE *input, unsigned long long offset, unsigned long long length, const CodecOptions *options, ByteBuffer *output) {
+    //Every block but the last holds blockSize bytes, so the blocks of the range follow from the offset. The footer gives the position
+    //of the index and the index the position of every block frame, so the time does not grow with the size of the file.
+    STATS_TIMER(options->stats, start);
+    output->length = 0;
+    long long size = fileSize(input);
+    if (size < 0) {
+        fprintf(stderr, "Reading a range needs a file, a stream cannot seek\n");
+        return 1; //return 1 on error
+    }
+    unsigned long long end = (unsigned long long)size;
+    unsigned char header[CONTAINER_HEADER_SIZE + DICTIONARY_ID_SIZE];
+    size_t blockSize;
+    BlockFormat format;
+    if (end < CONTAINER_HEADER_SIZE || readAt(input, 0, header, CONTAINER_HEADER_SIZE) != 0 || end < containerHeaderLength(header)
+        || readAt(input, CONTAINER_HEADER_SIZE, header + CONTAINER_HEADER_SIZE, containerHeaderLength(header) - CONTAINER_HEADER_SIZE) != 0) {
+        fprintf(stderr, "Unsupported file format, the file was not compressed by this version of the program\n");
+        return 1;
+    }
+    if (readContainerHeader(header, options->dictionary, &blockSize, &format) != 0) {
+        return 1;
+    }
+    if (format.dictionary != NULL) { //small inputs are compressed with a dictionary, their files save the index
+        fprintf(stderr, "Files compressed with a dictionary have no block index, decompress them whole\n");
+        return 1;
+    }
+    if (end < containerHeaderLength(header) + FRAME_HEADER_SIZE + FOOTER_SIZE) {
+        fprintf(stderr, "Compressed file is corrupted\n");
+        return 1;
+    }
+
+    unsigned char footer[FOOTER_SIZE]; //number of blocks and position of the index
+    if (readAt(input, end - FOOTER_SIZE, footer, FOOTER_SIZE) != 0) {
+        fprintf(stderr, "Error reading the input\n");
+        return 1;
+    }
+    unsigned long long blockCount = getU64(footer);
+    unsigned long long indexOffset = getU64(footer + 8);
+    if (indexOffset < containerHeaderLength(header) + FRAME_HEADER_SIZE || indexOffset > end - FOOTER_SIZE || (end - FOOTER_SIZE - indexOffset) / 8 != blockCount
+        || (end - FOOTER_SIZE - indexOffset) % 8 != 0) { //the index fills the space between the end frame and the footer
+        fprintf(stderr, "Compressed file is corrupted\n");
+        return 1;
+    }
+    unsigned long long first = offset / blockSize; //first block of the range
+    if (length == 0 || first >= blockCount) { //nothing to read, a range behind the end is empty like reading behind the end of a file
+        return 0; //return 0 on success
+    }
+    if (length > ~0ULL - offset) {
+        length = ~0ULL - offset;
+    }
+    unsigned long long last = (offset + length - 1) / blockSize; //last block of the range
+    if (last >= blockCount) {
+        last = blockCount - 1;
+    }
+
+    ByteBuffer frame, ownerFrame, block; //frame of the block, frame of the block holding a reused table, decoded block
+    initByteBuffer(&frame);
+    initByteBuffer(&ownerFrame);
+    initByteBuffer(&block);
+    Arena arena;
+    initArena(&arena, ARENA_SIZE);
+    TableReference reference; //last code table stored in a block read so far
+    reference.owner = -1;
+    int result = 0;
+    for (unsigned long long b = first; b <= last && result == 0; b++) {
+        STATS_TIMER(options->stats, timer);
+        result = readFrame(input, indexOffset, b, ~(size_t)0, &frame);
+        if (result != 0) {
+            break;
+        }
+        STATS_LAP(options->stats, PHASE_INPUT, timer, frame.length, 0);
+        size_t rawLength = getU32(frame.data);
+        size_t compressedLength = getU32(frame.data + 4);
+        const unsigned char *data = frame.data + FRAME_HEADER_SIZE;
+        if (rawLength == 0 || rawLength > blockSize || (b + 1 < blockCount && rawLength != blockSize)) { //only the last block may be shorter, otherwise the offsets are wrong
+            fprintf(stderr, "Compressed file is corrupted\n");
+            result = 1;
+            break;
+        }
+        if (compressedLength >= 1 + BLOCK_OWNER_SIZE && data[0] == BLOCK_REPEAT
+            && (long long)getU32(data + 1) != reference.owner) { //the block reuses the table of an earlier block that was not read yet
+            unsigned long long owner = getU32(data + 1);
+            if (owner >= b || readFrame(input, indexOffset, owner, 1 + MAX_TABLE_SIZE, &ownerFrame) != 0 //the table follows the mode, the codes are not needed
+                || loadTableReference(ownerFrame.data + FRAME_HEADER_SIZE, ownerFrame.length - FRAME_HEADER_SIZE, (size_t)owner, &reference, &arena) != 0) {
+                if (owner >= b) {
+                    fprintf(stderr, "Compressed file is corrupted\n");
+                }
+                result = 1;
+                break;
+            }
+            STATS_LAP(options->stats, PHASE_READ_TABLE, timer, ownerFrame.length, 0);
+        }
+        result = decompressBlock(data, compressedLength, rawLength, (size_t)b, &format, &reference, &arena, &block, options->stats);
+        unsigned long long blockStart = b * blockSize; //offset of the first byte of the block in the uncompressed data
+        size_t sliceStart = offset > blockStart ? (size_t)(offset - blockStart) : 0; //part of the block inside the range
+        size_t sliceStop = offset + length - blockStart < rawLength ? (size_t)(offset + length - blockStart) : rawLength;
+        if (result == 0 && sliceStart < sliceStop) { //the range may start behind the end of a short last block
+            result = appendByteBuffer(output, block.data + sliceStart, sliceStop - sliceStart);
+        }
+    }
+
+    freeByteBuffer(&frame);
+    freeByteBuffer(&ownerFrame);
+    freeByteBuffer(&block);
+    freeArena(&arena);
+    STATS_CALL(finishStats(options->stats, start));
+    return result; //return 0 on success
+}
+
+/*read the frame of block b, found through the index, into a byte buffer, with at most limit bytes of the compressed block*/
+int readFrame(FILE *input, unsigned long long indexOffset, unsigned long long b, size_t limit, ByteBuffer *frame) {
+    unsigned char entry[8];
+    frame->length = 0;
+    if (readAt(input, indexOffset + 8 * b, entry, 8) != 0 || reserveByteBuffer(frame, FRAME_HEADER_SIZE) != 0) {
+        fprintf(stderr, "Error reading the input\n");
+        return 1; //return 1 on error
+    }
+    unsigned long long position = getU64(entry);
+    if (position > indexOffset || indexOffset - position < FRAME_HEADER_SIZE || readAt(input, position, frame->data, FRAME_HEADER_SIZE) != 0) {
+        fprintf(stderr, "Compressed file is corrupted\n");
+        return 1;
+    }
+    size_t compressedLength = getU32(frame->data + 4);
+    if (compressedLength > indexOffset - position - FRAME_HEADER_SIZE) { //the block has to end before the index
+        fprintf(stderr, "Compressed file is corrupted\n");
+        return 1;
+    }
+    frame->length = FRAME_HEADER_SIZE;
+    if (compressedLength > limit) { //the frame header keeps the whole length, the caller knows how much it asked for
+        compressedLength = limit;
+    }
+    if (reserveByteBuffer(frame, compressedLength) != 0 || readAt(input, position + FRAME_HEADER_SIZE, frame->data + FRAME_HEADER_SIZE, compressedLength) != 0) {
+        fprintf(stderr, "Error reading the input\n");
+        return 1;
+    }
+    frame->length += compressedLength;
+    return 0; //return 0 on success
+}
+
+/*Streaming API-----------------------------------------------------------------------------------------------------------*/
+/*initialise a streaming encoder, the container header is the first output*/
+int initEncoder(HuffmanEncoder *encoder, const CodecOptions *options) {
+    encoder->block = NULL; //set up first, so freeEncoder works even if the options are rejected
+    initByteBuffer(&encoder->compressed);
+    initByteBuffer(&encoder->pending);
+    initByteBuffer(&encoder->index);
+    initArena(&encoder->arena, ARENA_SIZE);
+    if (checkCodecOptions(options) != 0) {
+        return 1; //return 1 on error
+    }
+    encoder->blockSize = options->blockSize;
+    encoder->maxCodeLength = options->maxCodeLength;
+    encoder->format.dictionary = options->dictionary;
+    encoder->format.numberStreams = options->numberStreams;
+    encoder->stats = options->stats;
+    encoder->block = malloc(encoder->blockSize);
+    if (encoder->block == NULL) {
+        fprintf(stderr, "Error allocating memory for the encoder\n");
+        return 1;
+    }
+    return resetEncoder(encoder);
+}
+
+/*start a new file with a streaming encoder, keeps its memory so many small files do not allocate again*/
+int resetEncoder(HuffmanEncoder *encoder) {
+    encoder->blockLength = 0;
+    encoder->pending.length = 0;
+    encoder->pendingPosition = 0;
+    encoder->index.length = 0;
+    encoder->blockCount = 0;
+    encoder->reference.owner = -1; //the first block cannot reuse a table
+    encoder->finished = 0;
+
+    unsigned char header[CONTAINER_HEADER_SIZE + DICTIONARY_ID_SIZE]; //same header as compressFile
+    size_t headerLength = writeContainerHeader(header, encoder->blockSize, &encoder->format);
+    encoder->position = headerLength;
+    return appendByteBuffer(&encoder->pending, header, headerLength);
+}
+
+/*compress the collected block and queue its frame*/
+int encodeCollectedBlock(HuffmanEncoder *encoder) {
+    if (compressBlock(encoder->block, encoder->blockLength, encoder->maxCodeLength, &encoder->format, encoder->blockCount, &encoder->reference, &encoder->arena, &encoder->compressed, encoder->stats) != 0) {
+        return 1; //return 1 on error
+    }
+    unsigned char frame[COMPACT_FRAME_HEADER_SIZE];
+    size_t frameLength = writeFrameHeader(frame, encoder->blockLength, encoder->compressed.length, &encoder->format);
+    unsigned char entry[8]; //index entry: position of the frame
+    putU64(entry, encoder->position);
+    if ((encoder->format.dictionary == NULL && appendByteBuffer(&encoder->index, entry, 8) != 0) //files with a dictionary have no index
+        || appendByteBuffer(&encoder->pending, frame, frameLength) != 0
+        || appendByteBuffer(&encoder->pending, encoder->compressed.data, encoder->compressed.length) != 0) {
+        return 1;
+    }
+    encoder->position += frameLength + encoder->compressed.length;
+    encoder->blockCount++;
+    encoder->blockLength = 0;
+    return 0; //return 0 on success
+}
+
+/*copy as much of a pending buffer as fits into the caller's output, returns the number of bytes copied*/
+size_t drainPending(ByteBuffer *pending, size_t *pendingPosition, unsigned char *output, size_t outputCapacity) {
+    size_t length = pending->length - *pendingPosition;
+    if (length > outputCapacity) {
+        length = outputCapacity;
+    }
+    if (length > 0) {
+        memcpy(output, pending->data + *pendingPosition, length);
+    }
+    *pendingPosition += length;
+    if (*pendingPosition == pending->length) { //everything was copied, the buffer can be reused
+        pending->length = 0;
+        *pendingPosition = 0;
+    }
+    return length;
+}
+
+/*feed input to a streaming encoder, stops when the input is used up or the output is full*/
+int updateEncoder(HuffmanEncoder *encoder, const unsigned char *input, size_t inputLength, size_t *inputUsed, unsigned char *output, size_t outputCapacity, size_t *outputUsed) {
+    *inputUsed = 0;
+    *outputUsed = 0;
+    while (1) {
+        *outputUsed += drainPending(&encoder->pending, &encoder->pendingPosition, output + *outputUsed, outputCapacity - *outputUsed);
+        if (encoder->pending.length != 0 || *inputUsed == inputLength) { //output full or input used up, the caller has to come back
+            return 0; //return 0 on success
+        }
+        size_t length = encoder->blockSize - encoder->blockLength; //room left in the block
+        if (length > inputLength - *inputUsed) {
+            length = inputLength - *inputUsed;
+        }
+        memcpy(encoder->block + encoder->blockLength, input + *inputUsed, length);
+        encoder->blockLength += length;
+        *inputUsed += length;
+        if (encoder->blockLength == encoder->blockSize && encodeCollectedBlock(encoder) != 0) { //block full, compress it
+            return 1; //return 1 on error
+        }
+    }
+}
+
+/*finish a streaming encoder: last block, end frame, index and footer (not with a dictionary), call until done is 1*/
+int finishEncoder(HuffmanEncoder *encoder, unsigned char *output, size_t outputCapacity, size_t *outputUsed, int *done) {
+    if (!encoder->finished) {
+        if (encoder->blockLength > 0 && encodeCollectedBlock(encoder) != 0) { //compress the last, shorter block
+            return 1; //return 1 on error
+        }
+        unsigned char frame[COMPACT_FRAME_HEADER_SIZE]; //empty end frame
+        size_t frameLength = writeFrameHeader(frame, 0, 0, &encoder->format);
+        unsigned char footer[FOOTER_SIZE];
+        putU64(footer, encoder->blockCount);
+        putU64(footer + 8, encoder->position + frameLength); //the index follows the end frame
+        if (appendByteBuffer(&encoder->pending, frame, frameLength) != 0
+            || (encoder->format.dictionary == NULL && (appendByteBuffer(&encoder->pending, encoder->index.data, encoder->index.length) != 0
+                                                       || appendByteBuffer(&encoder->pending, footer, FOOTER_SIZE) != 0))) { //files with a dictionary end with the end frame
+            return 1;
+        }
+        encoder->finished = 1;
+    }
+    *outputUsed = drainPending(&encoder->pending, &encoder->pendingPosition, output, outputCapacity);
+    *done = encoder->pending.length == 0;
+    return 0; //return 0 on success
+}
+
+/*free the memory of a streaming encoder*/
+void freeEncoder(HuffmanEncoder *encoder) {
+    free(encoder->block);
+    encoder->block = NULL;
+    freeByteBuffer(&encoder->compressed);
+    freeByteBuffer(&encoder->pending);
+    freeByteBuffer(&encoder->index);
+    freeArena(&encoder->arena);
+}
+
+/*initialise a streaming decoder*/
+void initDecoder(HuffmanDecoder *decoder, const CodecOptions *options) {
+    decoder->dictionary = options->dictionary; //only used if the stream asks for it
+    decoder->stats = options->stats;
+    initByteBuffer(&decoder->frame);
+    initByteBuffer(&decoder->decoded);
+    initArena(&decoder->arena, ARENA_SIZE);
+    resetDecoder(decoder);
+}
+
+/*start a new file with a streaming decoder, keeps its memory so many small files do not allocate again*/
+void resetDecoder(HuffmanDecoder *decoder) {
+    decoder->state = DECODER_HEADER;
+    decoder->format.dictionary = NULL;
+    decoder->format.numberStreams = 1;
+    decoder->collectedLength = 0;
+    decoder->blockSize = 0;
+    decoder->rawLength = 0;
+    decoder->compressedLength = 0;
+    decoder->frame.length = 0;
+    decoder->decoded.length = 0;
+    decoder->decodedPosition = 0;
+    decoder->reference.owner = -1;
+    decoder->blockIndex = 0;
+}
+
+/*feed compressed input to a streaming decoder, stops when the input is used up or the output is full*/
+int updateDecoder(HuffmanDecoder *decoder, const unsigned char *input, size_t inputLength, size_t *inputUsed, unsigned char *output, size_t outputCapacity, size_t *outputUsed) {
+    *inputUsed = 0;
+    *outputUsed = 0;
+    while (1) {
+        *outputUsed += drainPending(&decoder->decoded, &decoder->decodedPosition, output + *outputUsed, outputCapacity - *outputUsed);
+        if (decoder->decoded.length != 0 || *inputUsed == inputLength) { //output full or input used up, the caller has to come back
+            return 0; //return 0 on success
+        }
+        size_t available = inputLength - *inputUsed;
+
+        if (decoder->state == DECODER_TRAILER) { //index and footer are only needed for seeking, skip them
+            *inputUsed = inputLength;
+        }
+        else if (decoder->state == DECODER_HEADER || decoder->state == DECODER_FRAME_HEADER) { //collect the bytes of a header
+            size_t needed = 8; //frame headers and the start of the container header, which tells if a dictionary ID follows
+            if (decoder->state == DECODER_HEADER && decoder->collectedLength >= CONTAINER_HEADER_SIZE) {
+                needed = containerHeaderLength(decoder->collected);
+            }
+            else if (decoder->state == DECODER_FRAME_HEADER && decoder->format.dictionary != NULL) { //compact frame headers are collected byte by byte until they are whole
+                needed = decoder->collectedLength + 1;
+            }
+            size_t length = needed - decoder->collectedLength;
+            if (length > available) {
+                length = available;
+            }
+            memcpy(decoder->collected + decoder->collectedLength, input + *inputUsed, length);
+            decoder->collectedLength += length;
+            *inputUsed += length;
+            if (decoder->collectedLength < needed || (decoder->state == DECODER_HEADER && containerHeaderLength(decoder->collected) > needed)) {
+                continue; //header not complete yet
+            }
+            size_t frameLength = 0;
+            if (decoder->state == DECODER_FRAME_HEADER) {
+                frameLength = readFrameHeader(decoder->collected, decoder->collectedLength, &decoder->format, &decoder->rawLength, &decoder->compressedLength);
+                if (frameLength == 0 && decoder->collectedLength < COMPACT_FRAME_HEADER_SIZE) {
+                    continue;
+                }
+            }
+            decoder->collectedLength = 0;
+
+            if (decoder->state == DECODER_HEADER) { //container header
+                if (readContainerHeader(decoder->collected, decoder->dictionary, &decoder->blockSize, &decoder->format) != 0) {
+                    return 1; //return 1 on error
+                }
+                decoder->state = DECODER_FRAME_HEADER;
+            }
+            else { //frame header
+                if (frameLength == 0) { //a compact frame header that does not end
+                    fprintf(stderr, "Compressed file is corrupted\n");
+                    return 1;
+                }
+                if (decoder->rawLength == 0) { //empty frame marks the end of the blocks
+                    decoder->state = DECODER_TRAILER;
+                    continue;
+                }
+                if (decoder->rawLength > decoder->blockSize) {
+                    fprintf(stderr, "Compressed file is corrupted\n");
+                    return 1;
+                }
+                decoder->frame.length = 0;
+                decoder->state = DECODER_FRAME;
+            }
+        }
+        else { //collect the compressed block, then decompress it
+            size_t length = decoder->compressedLength - decoder->frame.length;
+            if (length > available) {
+                length = available;
+            }
+            if (appendByteBuffer(&decoder->frame, input + *inputUsed, length) != 0) {
+                return 1;
+            }
+            *inputUsed += length;
+            if (decoder->frame.length == decoder->compressedLength) { //whole block collected
+                if (decompressBlock(decoder->frame.data, decoder->frame.length, decoder->rawLength, decoder->blockIndex, &decoder->format, &decoder->reference, &decoder->arena, &decoder->decoded, decoder->stats) != 0) {
+                    return 1;
+                }
+                decoder->blockIndex++;
+                decoder->decodedPosition = 0;
+                decoder->state = DECODER_FRAME_HEADER;
+            }
+        }
+    }
+}
+
+/*finish a streaming decoder, fails if the input ended before the end frame*/
+int finishDecoder(HuffmanDecoder *decoder) {
+    if (decoder->state != DECODER_TRAILER) {
+        fprintf(stderr, "Compressed file is truncated\n");
+        return 1; //return 1 on error
+    }
+    return 0; //return 0 on success
+}
+
+/*free the memory of a streaming decoder*/
+void freeDecoder(HuffmanDecoder *decoder) {
+    freeByteBuffer(&decoder->frame);
+    freeByteBuffer(&decoder->decoded);
+    freeArena(&decoder->arena);
+}
+
+/*compress a stream such as stdin with the streaming encoder*/
+int compressStream(FILE *input, FILE *output, const CodecOptions *options) {
+    if (options->verbose) {
+        fprintf(stderr, "Compressing stream\n");
+    }
+    STATS_TIMER(options->stats, start);
+    HuffmanEncoder encoder;
+    unsigned long long inputTotal = 0, outputTotal = 0; //counted for the statistics
+    unsigned char *inBuffer = malloc(IO_BUFFER_SIZE);
+    unsigned char *outBuffer = malloc(IO_BUFFER_SIZE);
+    int result = inBuffer == NULL || outBuffer == NULL || initEncoder(&encoder, options) != 0;
+    if (result == 0) {
+        result = encodeFileStream(&encoder, input, output, inBuffer, outBuffer, &inputTotal, &outputTotal);
+    }
+    if (result == 0 && options->verbose) {
+        summarizeCompression(inputTotal, outputTotal); //print compression statistics to terminal
+    }
+
+    if (inBuffer != NULL && outBuffer != NULL) {
+        freeEncoder(&encoder);
+    }
+    free(inBuffer);
+    free(outBuffer);
+    STATS_CALL(finishStats(options->stats, start));
+    return result; //return 0 on success
+}
+
+/*compress one file from input to output with an encoder, which is reset first so it can be reused, and count the bytes read and written*/
+int encodeFileStream(HuffmanEncoder *encoder, FILE *input, FILE *output, unsigned char *inBuffer, unsigned char *outBuffer, unsigned long long *inputTotal, unsigned long long *outputTotal) {
+    *inputTotal = 0;
+    *outputTotal = 0;
+    int result = resetEncoder(encoder);
+    STATS_TIMER(encoder->stats, timer); //only the reads and writes are timed here, the encoder times its own phases
+
+    size_t inLength;
+    while (result == 0 && (inLength = fread(inBuffer, 1, IO_BUFFER_SIZE, input)) > 0) { //read the input in chunks
+        STATS_LAP(encoder->stats, PHASE_INPUT, timer, inLength, 0);
+        size_t inPosition = 0;
+        while (result == 0 && inPosition < inLength) { //the encoder may need several calls to take the whole chunk
+            size_t inUsed, outUsed;
+            result = updateEncoder(encoder, inBuffer + inPosition, inLength - inPosition, &inUsed, outBuffer, IO_BUFFER_SIZE, &outUsed);
+            STATS_RESTART(encoder->stats, timer);
+            fwrite(outBuffer, 1, outUsed, output);
+            STATS_LAP(encoder->stats, PHASE_WRITE_OUTPUT, timer, outUsed, 0);
+            inPosition += inUsed;
+            *outputTotal += outUsed;
+        }
+        *inputTotal += inLength;
+        STATS_RESTART(encoder->stats, timer);
+    }
+    if (result == 0 && ferror(input)) {
+        fprintf(stderr, "Error reading the input\n");
+        result = 1; //return 1 on error
+    }
+    int done = 0;
+    while (result == 0 && !done) { //write the rest of the output
+        size_t outUsed;
+        result = finishEncoder(encoder, outBuffer, IO_BUFFER_SIZE, &outUsed, &done);
+        STATS_RESTART(encoder->stats, timer);
+        fwrite(outBuffer, 1, outUsed, output);
+        STATS_LAP(encoder->stats, PHASE_WRITE_OUTPUT, timer, outUsed, 0);
+        *outputTotal += outUsed;
+    }
+    return result; //return 0 on success
+}
+
+/*decompress a stream such as stdin with the streaming decoder*/
+int decompressStream(FILE *input, FILE *output, const CodecOptions *options) {
+    if (options->verbose) { //the block size is read from the stream and the streaming decoder runs on the calling thread
+        fprintf(stderr, "Decompressing stream\n");
+    }
+    STATS_TIMER(options->stats, start);
+    HuffmanDecoder decoder;
+    initDecoder(&decoder, options);
+    unsigned long long inputTotal = 0, outputTotal = 0;
+    unsigned char *inBuffer = malloc(IO_BUFFER_SIZE);
+    unsigned char *outBuffer = malloc(IO_BUFFER_SIZE);
+    int result = inBuffer == NULL || outBuffer == NULL;
+    if (result == 0) {
+        result = decodeFileStream(&decoder, input, output, inBuffer, outBuffer, &inputTotal, &outputTotal);
+    }
+
+    freeDecoder(&decoder);
+    free(inBuffer);
+    free(outBuffer);
+    STATS_CALL(finishStats(options->stats, start));
+    return result; //return 0 on success
+}
+
+/*decompress one file from input to output with a decoder, which is reset first so it can be reused, and count the bytes read and written*/
+int decodeFileStream(HuffmanDecoder *decoder, FILE *input, FILE *output, unsigned char *inBuffer, unsigned char *outBuffer, unsigned long long *inputTotal, unsigned long long *outputTotal) {
+    *inputTotal = 0;
+    *outputTotal = 0;
+    resetDecoder(decoder);
+    int result = 0;
+    STATS_TIMER(decoder->stats, timer); //only the reads and writes are timed here, the decoder times its own phases
+
+    size_t inLength;
+    while (result == 0 && (inLength = fread(inBuffer, 1, IO_BUFFER_SIZE, input)) > 0) { //read the input in chunks
+        STATS_LAP(decoder->stats, PHASE_INPUT, timer, inLength, 0);
+        size_t inPosition = 0;
+        while (result == 0 && inPosition < inLength) {
+            size_t inUsed, outUsed;
+            result = updateDecoder(decoder, inBuffer + inPosition, inLength - inPosition, &inUsed, outBuffer, IO_BUFFER_SIZE, &outUsed);
+            STATS_RESTART(decoder->stats, timer);
+            fwrite(outBuffer, 1, outUsed, output);
+            STATS_LAP(decoder->stats, PHASE_WRITE_OUTPUT, timer, outUsed, 0);
+            inPosition += inUsed;
+            *outputTotal += outUsed;
+        }
+        *inputTotal += inLength;
+        STATS_RESTART(decoder->stats, timer);
+    }
+    if (result == 0 && ferror(input)) {
+        fprintf(stderr, "Error reading the input\n");
+        result = 1; //return 1 on error
+    }
+    while (result == 0 && decoder->decoded.length != 0) { //write what is left of the last block
+        size_t inUsed, outUsed;
+        result = updateDecoder(decoder, NULL, 0, &inUsed, outBuffer, IO_BUFFER_SIZE, &outUsed);
+        STATS_RESTART(decoder->stats, timer);
+        fwrite(outBuffer, 1, outUsed, output);
+        STATS_LAP(decoder->stats, PHASE_WRITE_OUTPUT, timer, outUsed, 0);
+        *outputTotal += outUsed;
+    }
+    if (result == 0) {
+        result = finishDecoder(decoder);
+    }
+    return result; //return 0 on success
+}
+
+/*Batch mode functions----------------------------------------------------------------------------------------------------*/
+/*compress or decompress many files on worker threads, returns 0 if every file was coded*/
+int runBatch(int mode, const char **inputNames, int numberInputs, const char *listName, const char *outputDirectory, const CodecOptions *options) {
+    //Every worker codes whole files one after the other with its own streaming encoder and decoder, set up once and reset for every file.
+    //Many small files are coded in one process and on every core, instead of starting a process per file.
+    if (checkCodecOptions(options) != 0) {
+        return 1; //return 1 on error
+    }
+    FileList files;
+    initFileList(&files);
+    int result = 0;
+    for (int i = 0; i < numberInputs && result == 0; i++) {
+        result = addBatchInput(&files, inputNames[i], mode);
+    }
+    if (result == 0 && listName != NULL) { //one file name per line
+        FILE *list = strcmp(listName, "-") == 0 ? stdin : fopen(listName, "r");
+        if (list == NULL) {
+            fprintf(stderr, "Could not open %s\n", listName);
+            result = 1;
+        }
+        else {
+            result = readFileList(list, &files);
+            if (list != stdin) {
+                fclose(list);
+            }
+        }
+    }
+    if (result == 0 && files.count == 0) {
+        fprintf(stderr, "No files to (de-)compress\n");
+        result = 1;
+    }
+    char **outputNames = result == 0 ? calloc(files.count, sizeof(char *)) : NULL; //every output is named before any file is coded
+    if (result == 0 && (outputNames == NULL || nameBatchOutputs(&files, mode, outputDirectory, outputNames) != 0)) {
+        if (outputNames == NULL) {
+            fprintf(stderr, "Error allocating memory for the output names\n");
+        }
+        result = 1;
+    }
+    if (result != 0) {
+        if (outputNames != NULL) {
+            for (size_t i = 0; i < files.count; i++) {
+                free(outputNames[i]);
+            }
+        }
+        free(outputNames);
+        freeFileList(&files);
+        return 1;
+    }
+
+    BatchJob job;
+    job.files = &files;
+    job.mode = mode;
+    job.outputNames = outputNames;
+    job.options = options;
+    job.nextFile = 0;
+    job.failedFiles = 0;
+    job.inputBytes = 0;
+    job.outputBytes = 0;
+    int numberThreads = options->numberThreads < 1 ? 1 : options->numberThreads > MAX_THREADS ? MAX_THREADS : options->numberThreads;
+    if ((size_t)numberThreads > files.count) { //a worker without a file would only set up its encoder
+        numberThreads = (int)files.count;
+    }
+    BatchWorker *workers = calloc(numberThreads, sizeof(BatchWorker));
+    Thread *threads = malloc(numberThreads * sizeof(Thread));
+    if (workers == NULL || threads == NULL) {
+        fprintf(stderr, "Error allocating memory for the batch workers\n");
+        free(workers);
+        free(threads);
+        for (size_t i = 0; i < files.count; i++) {
+            free(outputNames[i]);
+        }
+        free(outputNames);
+        freeFileList(&files);
+        return 1;
+    }
+    initMutex(&job.mutex);
+
+    double start = currentSeconds();
+    int startedThreads = 0;
+    while (startedThreads < numberThreads) { //start the workers
+        workers[startedThreads].job = &job;
+        if (startThread(&threads[startedThreads], batchWorker, &workers[startedThreads]) != 0) {
+            break;
+        }
+        startedThreads++;
+    }
+    if (startedThreads == 0) { //without any worker no file would ever be coded
+        fprintf(stderr, "Error starting worker threads\n");
+        result = 1;
+    }
+    for (int i = 0; i < startedThreads; i++) { //wait for all workers to finish
+        joinThread(threads[i]);
+        if (options->stats != NULL) {
+            addStats(options->stats, &workers[i].stats);
+        }
+    }
+    double seconds = currentSeconds() - start;
+    STATS_CALL(finishStats(options->stats, start));
+
+    if (result == 0) { //stdout carries no data in the batch mode
+        printf("Batch: %llu files, %llu failed, %llu bytes read, %llu bytes written in %.3f s, %.1f MB/s on %d threads\n",
+               (unsigned long long)files.count, (unsigned long long)job.failedFiles, job.inputBytes, job.outputBytes, seconds,
+               seconds > 0 ? (double)job.inputBytes / 1e6 / seconds : 0.0, startedThreads);
+        result = job.failedFiles > 0;
+    }
+    destroyMutex(&job.mutex);
+    free(workers);
+    free(threads);
+    for (size_t i = 0; i < files.count; i++) {
+        free(outputNames[i]);
+    }
+    free(outputNames);
+    freeFileList(&files);
+    return result; //return 0 on success
+}
+
+/*function run by every worker thread of the batch mode*/
+void *batchWorker(void *argument) {
+    BatchWorker *worker = argument;
+    BatchJob *job = worker->job;
+    CodecOptions options = *job->options; //the workers count their statistics on their own
+    initStats(&worker->stats);
+    options.stats = job->options->stats != NULL ? &worker->stats : NULL;
+
+    worker->inBuffer = malloc(IO_BUFFER_SIZE);
+    worker->outBuffer = malloc(IO_BUFFER_SIZE);
+    worker->hasEncoder = job->mode != 2; //the encoder holds a whole block, so it is only set up if files are compressed
+    int ready = worker->inBuffer != NULL && worker->outBuffer != NULL;
+    if (worker->hasEncoder && initEncoder(&worker->encoder, &options) != 0) {
+        ready = 0;
+    }
+    initDecoder(&worker->decoder, &options);
+    if (!ready) {
+        fprintf(stderr, "Error allocating memory for a batch worker\n");
+    }
+
+    lockMutex(&job->mutex);
+    while (job->nextFile < job->files->count) {
+        size_t file = job->nextFile++; //take the next file
+        unlockMutex(&job->mutex);
+        unsigned long long inputBytes = 0, outputBytes = 0;
+        int failed = !ready || job->outputNames[file] == NULL //the reason was reported when the outputs were named
+                     || codeBatchFile(worker, job->files->names[file], job->outputNames[file], &inputBytes, &outputBytes) != 0;
+        lockMutex(&job->mutex);
+        if (failed) {
+            job->failedFiles++;
+        }
+        else {
+            job->inputBytes += inputBytes;
+            job->outputBytes += outputBytes;
+        }
+    }
+    unlockMutex(&job->mutex);
+
+    if (worker->hasEncoder) {
+        freeEncoder(&worker->encoder);
+    }
+    freeDecoder(&worker->decoder);
+    free(worker->inBuffer);
+    free(worker->outBuffer);
+    return NULL;
+}
+
+/*compress or decompress one file of the batch mode with the encoder or decoder of a worker, a failed output is removed*/
+int codeBatchFile(BatchWorker *worker, const char *inputName, const char *outputName, unsigned long long *inputBytes, unsigned long long *outputBytes) {
+    BatchJob *job = worker->job;
+    int mode = job->mode != 0 ? job->mode : getFileType((char *)inputName); //files of unknown type got no output name
+    FILE *input = fopen(inputName, "rb");
+    FILE *output = input != NULL ? fopen(outputName, "wb") : NULL;
+    if (output == NULL) {
+        fprintf(stderr, "Could not open %s\n", input == NULL ? inputName : outputName);
+        if (input != NULL) {
+            fclose(input);
+        }
+        return 1; //return 1 on error
+    }
+
+    int result;
+    if (mode == 1) {
+        result = encodeFileStream(&worker->encoder, input, output, worker->inBuffer, worker->outBuffer, inputBytes, outputBytes);
+    }
+    else {
+        result = decodeFileStream(&worker->decoder, input, output, worker->inBuffer, worker->outBuffer, inputBytes, outputBytes);
+    }
+    fclose(input);
+    if (ferror(output)) { //report write errors such as a full disk
+        fprintf(stderr, "Error writing %s\n", outputName);
+        result = 1;
+    }
+    if (fclose(output) != 0) {
+        result = 1;
+    }
+    if (result != 0) {
+        fprintf(stderr, "%s: could not be %s\n", inputName, mode == 1 ? "compressed" : "decompressed");
+        remove(outputName); //do not leave a partial output behind
+    }
+    else if (job->options->verbose) {
+        fprintf(stderr, "%s -> %s\n", inputName, outputName);
+    }
+    return result; //return 0 on success
+}
+
+/*name the output of every file of the batch mode, files that cannot be coded keep NULL, returns 1 only if memory ran out*/
+int nameBatchOutputs(const FileList *files, int mode, const char *outputDirectory, char **outputNames) {
+    //Two files writing the same output, such as a/log.txt and b/log.txt with -O, would overwrite each other while both are coded,
+    //and a file whose output is the input of another one, such as x.txt and x.bin without -c or -d, would be read while it is written.
+    //All input and output names are sorted together, and every file of a group of equal names is left out.
+    BatchName *names = malloc(2 * files->count * sizeof(BatchName));
+    if (names == NULL) {
+        fprintf(stderr, "Error allocating memory for the output names\n");
+        return 1; //return 1 on error
+    }
+    size_t numberNames = 0;
+    for (size_t file = 0; file < files->count; file++) {
+        int fileMode = mode != 0 ? mode : getFileType(files->names[file]); //without -c or -d, decide from the name like codeFiles
+        if (fileMode == 0) {
+            fprintf(stderr, "%s: use -c to compress or -d to decompress\n", files->names[file]);
+            continue;
+        }
+        outputNames[file] = batchOutputName(files->names[file], fileMode, outputDirectory);
+        if (outputNames[file] == NULL) {
+            free(names);
+            return 1;
+        }
+        names[numberNames].name = files->names[file];
+        names[numberNames++].file = file;
+        names[numberNames].name = outputNames[file];
+        names[numberNames++].file = file;
+    }
+    qsort(names, numberNames, sizeof(BatchName), compareBatchNames);
+
+    unsigned char *conflicts = calloc(files->count, 1); //1 for files left out, marked first because the sorted names point to the outputs
+    if (conflicts == NULL) {
+        fprintf(stderr, "Error allocating memory for the output names\n");
+        free(names);
+        return 1;
+    }
+    for (size_t i = 1; i < numberNames; i++) {
+        if (strcmp(names[i].name, names[i - 1].name) == 0) { //equal names are next to each other
+            conflicts[names[i].file] = 1;
+            conflicts[names[i - 1].file] = 1;
+        }
+    }
+    for (size_t file = 0; file < files->count; file++) {
+        if (conflicts[file]) {
+            fprintf(stderr, "%s: its output %s is written or read by another file of the batch, left out\n", files->names[file], outputNames[file]);
+            free(outputNames[file]);
+            outputNames[file] = NULL;
+        }
+    }
+    free(conflicts);
+    free(names);
+    return 0; //return 0 on success
+}
+
+/*compare two batch names for qsort, by name and then by file*/
+int compareBatchNames(const void *first, const void *second) {
+    const BatchName *a = first, *b = second;
+    int order = strcmp(a->name, b->name);
+    if (order != 0) {
+        return order;
+    }
+    return (a->file > b->file) - (a->file < b->file);
+}
+
+/*make the name of the output of a file in the batch mode, returns NULL on error*/
+char *batchOutputName(const char *inputName, int mode, const char *outputDirectory) {
+    //name.txt becomes name.bin when compressing and name.bin becomes name.txt when decompressing, other names get the extension appended.
+    //With an output directory, the output goes there under the name of the input without its directory.
+    const char *extension = mode == 1 ? ".bin" : ".txt";
+    const char *replaced = mode == 1 ? ".txt" : ".bin";
+    const char *base = inputName;
+    if (outputDirectory != NULL) {
+        for (const char *c = inputName; *c != '\0'; c++) {
+            if (strchr(PATH_SEPARATORS, *c) != NULL) {
+                base = c + 1;
+            }
+        }
+    }
+    size_t baseLength = strlen(base);
+    if (baseLength > 4 && strcmp(base + baseLength - 4, replaced) == 0) {
+        baseLength -= 4;
+    }
+    size_t directoryLength = outputDirectory != NULL ? strlen(outputDirectory) : 0;
+    char *name = malloc(directoryLength + 1 + baseLength + strlen(extension) + 1);
+    if (name == NULL) {
+        fprintf(stderr, "Error allocating memory for a file name\n");
+        return NULL; //return NULL on error
+    }
+    size_t position = 0;
+    if (outputDirectory != NULL) {
+        memcpy(name, outputDirectory, directoryLength);
+        position = directoryLength;
+        if (directoryLength > 0 && strchr(PATH_SEPARATORS, name[directoryLength - 1]) == NULL) {
+            name[position++] = '/';
+        }
+    }
+    memcpy(name + position, base, baseLength);
+    strcpy(name + position + baseLength, extension);
+    return name;
+}
+
+/*add an input of the batch mode: a file, or every .txt (-c) or .bin (-d) file of a directory*/
+int addBatchInput(FileList *list, const char *name, int mode) {
+    if (!isDirectory(name)) {
+        return addFileName(list, name, strlen(name));
+    }
+    if (mode == 0) { //a directory holding name.txt and name.bin would be coded in both directions at once
+        fprintf(stderr, "Use -c or -d to (de-)compress the files of the directory %s\n", name);
+        return 1; //return 1 on error
+    }
+    return listDirectory(name, mode, list);
+}
+
+/*add the regular files of a directory whose type (.txt or .bin) matches the mode, subdirectories are left out*/
+int listDirectory(const char *directory, int mode, FileList *list) {
+    size_t directoryLength = strlen(directory);
+    int separator = directoryLength > 0 && strchr(PATH_SEPARATORS, directory[directoryLength - 1]) == NULL; //1 if a / has to go between directory and file name
+    ByteBuffer path; //directory, separator and the name of the entry
+    initByteBuffer(&path);
+    int result = 0;
+#ifdef _WIN32
+    if (appendByteBuffer(&path, directory, directoryLength) != 0 || appendByteBuffer(&path, separator ? "/*" : "*", separator ? 3 : 2) != 0) {
+        freeByteBuffer(&path);
+        return 1; //return 1 on error
+    }
+    WIN32_FIND_DATAA entry;
+    HANDLE search = FindFirstFileA((const char *)path.data, &entry);
+    if (search == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "Could not read the directory %s\n", directory);
+        freeByteBuffer(&path);
+        return 1;
+    }
+    do {
+        if ((entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) || getFileType(entry.cFileName) != mode) {
+            continue;
+        }
+        path.length = directoryLength + separator;
+        if (appendByteBuffer(&path, entry.cFileName, strlen(entry.cFileName) + 1) != 0 || addFileName(list, (const char *)path.data, path.length - 1) != 0) {
+            result = 1;
+        }
+    } while (result == 0 && FindNextFileA(search, &entry));
+    FindClose(search);
+#else
+    DIR *handle = opendir(directory);
+    if (handle == NULL) {
+        fprintf(stderr, "Could not read the directory %s\n", directory);
+        return 1; //return 1 on error
+    }
+    if (appendByteBuffer(&path, directory, directoryLength) != 0 || (separator && appendByteBuffer(&path, "/", 1) != 0)) {
+        result = 1;
+    }
+    struct dirent *entry;
+    while (result == 0 && (entry = readdir(handle)) != NULL) {
+        if (getFileType(entry->d_name) != mode) {
+            continue;
+        }
+        path.length = directoryLength + separator;
+        struct stat fileStatus;
+        if (appendByteBuffer(&path, entry->d_name, strlen(entry->d_name) + 1) != 0) {
+            result = 1;
+        }
+        else if (stat((const char *)path.data, &fileStatus) == 0 && S_ISREG(fileStatus.st_mode)) { //only regular files, no subdirectories named like files
+            result = addFileName(list, (const char *)path.data, path.length - 1);
+        }
+    }
+    closedir(handle);
+#endif
+    freeByteBuffer(&path);
+    return result; //return 0 on success
+}
+
+/*check if a name is a directory*/
+int isDirectory(const char *name) {
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(name);
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    struct stat fileStatus;
+    return stat(name, &fileStatus) == 0 && S_ISDIR(fileStatus.st_mode);
+#endif
+}
+
+/*add one file name per line of a list file, empty lines are skipped*/
+int readFileList(FILE *file, FileList *list) {
+    ByteBuffer line; //lines can be of any length, so they are collected in a growable buffer
+    initByteBuffer(&line);
+    char chunk[1024];
+    int result = 0;
+    while (result == 0 && fgets(chunk, sizeof(chunk), file) != NULL) {
+        size_t length = strlen(chunk);
+        int complete = length > 0 && chunk[length - 1] == '\n';
+        result = appendByteBuffer(&line, chunk, length);
+        if (result == 0 && complete) {
+            while (line.length > 0 && (line.data[line.length - 1] == '\n' || line.data[line.length - 1] == '\r')) { //lists written on Windows end in \r\n
+                line.length--;
+            }
+            if (line.length > 0) {
+                result = addFileName(list, (const char *)line.data, line.length);
+            }
+            line.length = 0;
+        }
+    }
+    if (result == 0 && line.length > 0) { //last line without a newline
+        result = addFileName(list, (const char *)line.data, line.length);
+    }
+    if (result == 0 && ferror(file)) {
+        fprintf(stderr, "Error reading the file list\n");
+        result = 1;
+    }
+    freeByteBuffer(&line);
+    return result; //return 0 on success
+}
+
+/*initialise an empty file list*/
+void initFileList(FileList *list) {
+    list->names = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+/*add a copy of the first length characters of name to a file list*/
+int addFileName(FileList *list, const char *name, size_t length) {
+    if (list->count == list->capacity) { //make room for more names
+        size_t capacity = list->capacity == 0 ? 64 : 2 * list->capacity;
+        char **names = realloc(list->names, capacity * sizeof(char *));
+        if (names == NULL) {
+            fprintf(stderr, "Error allocating memory for the file list\n");
+            return 1; //return 1 on error
+        }
+        list->names = names;
+        list->capacity = capacity;
+    }
+    char *copy = malloc(length + 1);
+    if (copy == NULL) {
+        fprintf(stderr, "Error allocating memory for the file list\n");
+        return 1;
+    }
+    memcpy(copy, name, length);
+    copy[length] = '\0';
+    list->names[list->count++] = copy;
+    return 0; //return 0 on success
+}
+
+/*free a file list and its names*/
+void freeFileList(FileList *list) {
+    for (size_t i = 0; i < list->count; i++) {
+        free(list->names[i]);
+    }
+    free(list->names);
+    initFileList(list);
+}
+
+/*Benchmark functions-----------------------------------------------------------------------------------------------------*/
+/*get a monotonic time in seconds*/
+double currentSeconds(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+#endif
+}
+
+/*get the peak memory use of the process in kilobytes*/
+long long peakMemoryKilobytes(void) {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return -1;
+    }
+    return (long long)(counters.PeakWorkingSetSize / 1024);
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+#ifdef __APPLE__
+    return (long long)usage.ru_maxrss / 1024; //bytes on macOS
+#else
+    return (long long)usage.ru_maxrss; //kilobytes on Linux and the BSDs
+#endif
+#endif
+}
+
+/*fill a buffer with a synthetic benchmark input, profiles: 0 text, 1 random bytes, 2 skewed bytes, 3 one repeated byte*/
+void generateSynthetic(int profile, unsigned char *data, size_t length) {
+    static const char *words[] = {"lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit", "sed", "do", "eiusmod", "tempor",
+                                  "incididunt", "ut", "labore", "et", "dolore", "magna", "aliqua", "enim", "ad", "minim", "veniam", "quis"};
+    unsigned long long state = 0x9E3779B97F4A7C15ULL; //fixed seed, so every run codes the same input
+    size_t i = 0;
+    while (i < length) {
+        state ^= state << 13; //xorshift64
+        state ^= state >> 7;
+        state ^= state << 17;
+        if (profile == 0) { //words of very different frequencies, with some punctuation and line breaks like the example files
+            const char *word = words[(state >> 8) % 24 * ((state >> 16) % 24) / 24];
+            for (size_t k = 0; word[k] != '\0' && i < length; k++) {
+                data[i++] = (unsigned char)word[k];
+            }
+            if (i < length) {
+                data[i++] = (state & 0xF) == 0 ? '.' : (state & 0x3F) == 1 ? '\n' : ' ';
+            }
+        }
+        else if (profile == 1) { //every byte value equally likely, nothing to compress
+            data[i++] = (unsigned char)(state >> 24);
+        }
+        else if (profile == 2) { //byte value b has probability 2^-(b+1), gives the longest codes
+            unsigned long long bits = state | (1ULL << 63);
+            int value = 0;
+            while ((bits & 1) == 0) {
+                bits >>= 1;
+                value++;
+            }
+            data[i++] = (unsigned char)value;
+        }
+        else { //a single character, the smallest possible output
+            data[i++] = 'a';
+        }
+    }
+}
+
+/*compress a buffer in memory with the streaming encoder*/
+int compressBuffer(const unsigned char *data, size_t length, const CodecOptions *options, ByteBuffer *output) {
+    HuffmanEncoder encoder;
+    output->length = 0;
+    int result = initEncoder(&encoder, options);
+    size_t inPosition = 0;
+    int done = 0;
+    while (result == 0 && !done) { //the encoder writes straight into the free space of the output buffer
+        size_t inUsed = 0, outUsed;
+        result = reserveByteBuffer(output, IO_BUFFER_SIZE);
+        if (result == 0 && inPosition < length) {
+            result = updateEncoder(&encoder, data + inPosition, length - inPosition, &inUsed, output->data + output->length, output->capacity - output->length, &outUsed);
+        }
+        else if (result == 0) {
+            result = finishEncoder(&encoder, output->data + output->length, output->capacity - output->length, &outUsed, &done);
+        }
+        if (result == 0) {
+            output->length += outUsed;
+            inPosition += inUsed;
+        }
+    }
+    freeEncoder(&encoder);
+    return result; //return 0 on success
+}
+
+/*decompress a buffer in memory with the streaming decoder*/
+int decompressBuffer(const unsigned char *data, size_t length, const CodecOptions *options, ByteBuffer *output) {
+    HuffmanDecoder decoder;
+    initDecoder(&decoder, options);
+    output->length = 0;
+    size_t inPosition = 0;
+    int result = 0;
+    while (result == 0 && (inPosition < length || decoder.decoded.length != 0)) {
+        size_t inUsed, outUsed;
+        result = reserveByteBuffer(output, IO_BUFFER_SIZE);
+        if (result == 0) {
+            result = updateDecoder(&decoder, data + inPosition, length - inPosition, &inUsed, output->data + output->length, output->capacity - output->length, &outUsed);
+        }
+        if (result == 0) {
+            output->length += outUsed;
+            inPosition += inUsed;
+        }
+    }
+    if (result == 0) {
+        result = finishDecoder(&decoder);
+    }
+    freeDecoder(&decoder);
+    return result; //return 0 on success
+}
+
+/*decode every block of a compressed buffer into one reused block buffer, without the copies of the streaming decoder, for the decode-only timing*/
+int decodeBlocksOnly(const unsigned char *data, size_t length, const CodecOptions *options, ByteBuffer *block, unsigned long long *decodedTotal) {
+    *decodedTotal = 0;
+    size_t blockSize;
+    BlockFormat format;
+    if (length < CONTAINER_HEADER_SIZE || length < containerHeaderLength(data) || readContainerHeader(data, options->dictionary, &blockSize, &format) != 0) {
+        return 1; //return 1 on error
+    }
+    TableReference reference;
+    reference.owner = -1; //the first block cannot reuse a table
+    Arena arena;
+    initArena(&arena, ARENA_SIZE);
+    size_t position = containerHeaderLength(data);
+    int result = 0;
+    for (size_t b = 0; result == 0; b++) { //the frames follow each other up to the empty end frame
+        size_t rawLength, compressedLength;
+        size_t frameLength = readFrameHeader(data + position, length - position, &format, &rawLength, &compressedLength);
+        if (frameLength == 0) {
+            fprintf(stderr, "Compressed file is truncated\n");
+            result = 1;
+            break;
+        }
+        position += frameLength;
+        if (rawLength == 0) {
+            break;
+        }
+        if (rawLength > blockSize || compressedLength > length - position) {
+            fprintf(stderr, "Compressed file is corrupted\n");
+            result = 1;
+            break;
+        }
+        result = decompressBlock(data + position, compressedLength, rawLength, b, &format, &reference, &arena, block, NULL);
+        position += compressedLength;
+        *decodedTotal += rawLength;
+    }
+    freeArena(&arena);
+    return result; //return 0 on success
+}
+
+/*time counting the frequencies of an input block by block like planBlock, fastest of BENCH_RUNS runs, with countFrequencies or the simple loop*/
+double timeHistogram(const unsigned char *data, size_t length, size_t blockSize, int simple) {
+    Frequency frequency[ASCII_SIZE];
+    volatile int counted = 0; //the counts are read, so the compiler cannot leave out the counting
+    double fastest = 0;
+    size_t passes = length > 0 && length < DEFAULT_BENCH_SIZE ? DEFAULT_BENCH_SIZE / length : 1; //small inputs are counted again and again, so the clock can time them
+    for (int run = -1; run < BENCH_RUNS; run++) { //run -1 is not timed, it warms up the caches and the clock of the processor
+        double start = currentSeconds();
+        for (size_t pass = 0; pass < passes; pass++) {
+            for (size_t position = 0; position < length; position += blockSize) {
+                size_t blockLength = length - position < blockSize ? length - position : blockSize;
+                memset(frequency, 0, sizeof(frequency)); //both functions add to the counts
+                if (simple) {
+                    countFrequenciesSimple(data + position, blockLength, frequency);
+                }
+                else {
+                    countFrequencies(data + position, blockLength, frequency);
+                }
+                counted = frequency[data[position]].frequency;
+            }
+        }
+        double seconds = (currentSeconds() - start) / (double)passes;
+        if (run == 0 || (run > 0 && seconds < fastest)) {
+            fastest = seconds;
+        }
+    }
+    (void)counted;
+    return fastest;
+}
+
+/*benchmark one input and print its results as a JSON object, returns 0 if the round trip was correct*/
+int benchmarkBuffer(const char *name, const unsigned char *data, size_t length, const CodecOptions *options, int first) {
+    ByteBuffer compressed, decompressed;
+    initByteBuffer(&compressed);
+    initByteBuffer(&decompressed);
+    double compressSeconds = 0, decompressSeconds = 0; //fastest of BENCH_RUNS runs, the others are disturbed by caches and other processes
+    int result = 0;
+    for (int run = 0; run < BENCH_RUNS && result == 0; run++) {
+        double start = currentSeconds();
+        result = compressBuffer(data, length, options, &compressed);
+        double middle = currentSeconds();
+        if (result == 0) {
+            result = decompressBuffer(compressed.data, compressed.length, options, &decompressed);
+        }
+        double end = currentSeconds();
+        if (run == 0 || middle - start < compressSeconds) {
+            compressSeconds = middle - start;
+        }
+        if (run == 0 || end - middle < decompressSeconds) {
+            decompressSeconds = end - middle;
+        }
+    }
+    ByteBuffer block;
+    initByteBuffer(&block);
+    double decodeSeconds = 0; //the blocks alone, without the container and the copies of the streaming decoder
+    unsigned long long decodedTotal = 0;
+    for (int run = 0; run < BENCH_RUNS && result == 0; run++) {
+        double start = currentSeconds();
+        result = decodeBlocksOnly(compressed.data, compressed.length, options, &block, &decodedTotal);
+        double seconds = currentSeconds() - start;
+        if (run == 0 || seconds < decodeSeconds) {
+            decodeSeconds = seconds;
+        }
+    }
+    freeByteBuffer(&block);
+    int roundTrip = result == 0 && decodedTotal == length && decompressed.length == length && (length == 0 || memcmp(decompressed.data, data, length) == 0);
+    double histogramSeconds = timeHistogram(data, length, options->blockSize, 0);
+    double simpleHistogramSeconds = timeHistogram(data, length, options->blockSize, 1);
+    static const size_t smallBlocks[] = {1024, 4096, 16384}; //block sizes of small files and messages, where the count tables cost more than they save
+    double smallSeconds[3], smallSimpleSeconds[3];
+    for (int k = 0; k < 3; k++) {
+        smallSeconds[k] = timeHistogram(data, length, smallBlocks[k], 0);
+        smallSimpleSeconds[k] = timeHistogram(data, length, smallBlocks[k], 1);
+    }
+
+    double megabytes = (double)length / 1e6;
+    printf("%s\n    {\"name\": ", first ? "" : ",");
+    printJsonString(stdout, name);
+    printf(", \"bytes\": %llu, \"compressed_bytes\": %llu, \"ratio\": %.4f, ", (unsigned long long)length, (unsigned long long)compressed.length, length > 0 ? (double)compressed.length / (double)length : 0.0);
+    printf("\"compress_mb_s\": %.1f, \"decompress_mb_s\": %.1f, ", compressSeconds > 0 ? megabytes / compressSeconds : 0.0, decompressSeconds > 0 ? megabytes / decompressSeconds : 0.0);
+    printf("\"compress_ns_per_byte\": %.3f, \"decompress_ns_per_byte\": %.3f, ", length > 0 ? compressSeconds * 1e9 / (double)length : 0.0, length > 0 ? decompressSeconds * 1e9 / (double)length : 0.0);
+    printf("\"decode_only_mb_s\": %.1f, \"decode_only_ns_per_byte\": %.3f, ", decodeSeconds > 0 ? megabytes / decodeSeconds : 0.0, length > 0 ? decodeSeconds * 1e9 / (double)length : 0.0);
+    printf("\"histogram_mb_s\": %.1f, \"histogram_simple_mb_s\": %.1f, \"histogram_small_blocks\": [", histogramSeconds > 0 ? megabytes / histogramSeconds : 0.0,
+           simpleHistogramSeconds > 0 ? megabytes / simpleHistogramSeconds : 0.0);
+    for (int k = 0; k < 3; k++) {
+        printf("%s{\"block_bytes\": %llu, \"mb_s\": %.1f, \"simple_mb_s\": %.1f}", k > 0 ? ", " : "", (unsigned long long)smallBlocks[k],
+               smallSeconds[k] > 0 ? megabytes / smallSeconds[k] : 0.0, smallSimpleSeconds[k] > 0 ? megabytes / smallSimpleSeconds[k] : 0.0);
+    }
+    printf("], ");
+    printf("\"peak_rss_kb\": %lld, \"round_trip\": %s}", peakMemoryKilobytes(), roundTrip ? "true" : "false");
+    fflush(stdout); //results of long runs show up as soon as they are known
+
+    freeByteBuffer(&compressed);
+    freeByteBuffer(&decompressed);
+    return roundTrip ? 0 : 1; //return 0 on success
+}
+
+/*print a string as a JSON string, with quotes, backslashes and control characters escaped*/
+void printJsonString(FILE *file, const char *text) {
+    fputc('"', file);
+    for (const unsigned char *c = (const unsigned char *)text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(file, "\\%c", *c);
+        }
+        else if (*c < 0x20) {
+            fprintf(file, "\\u%04x", *c);
+        }
+        else {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+/*benchmark the given inputs, or the example files and synthetic inputs, and print the results as JSON*/
+int runBenchmark(const char **inputNames, int numberInputs, const CodecOptions *options, size_t syntheticSize) {
+    //Coding runs in memory on the calling thread with the streaming API, so the results measure the codec and not the disk.
+    //Peak RSS is the peak of the whole process up to that input, so inputs are best given in increasing size.
+    static const char *exampleNames[] = {"example1.txt", "example2.txt", "example3.txt"};
+    static const char *syntheticNames[] = {"synthetic-text", "synthetic-random", "synthetic-skewed", "synthetic-constant"};
+    int failed = 0;
+    int first = 1;
+
+    printf("{\"format_version\": %d, \"block_size\": %llu, \"max_code_length\": %d, \"streams\": %d, \"runs\": %d, \"threads\": 1, \"results\": [",
+           FORMAT_VERSION, (unsigned long long)options->blockSize, options->maxCodeLength, options->numberStreams, BENCH_RUNS);
+
+    int useExamples = numberInputs == 0; //without inputs, the example files that can be found are benchmarked
+    int numberFiles = useExamples ? 3 : numberInputs;
+    for (int i = 0; i < numberFiles; i++) {
+        const char *name = useExamples ? exampleNames[i] : inputNames[i];
+        FILE *file = fopen(name, "rb");
+        if (file == NULL) {
+            if (!useExamples) {
+                fprintf(stderr, "Could not open %s\n", name);
+                failed = 1;
+            }
+            continue;
+        }
+        InputData inputData;
+        if (loadInput(file, &inputData) != 0) {
+            fclose(file);
+            failed = 1;
+            continue;
+        }
+        failed |= benchmarkBuffer(name, inputData.data, inputData.length, options, first);
+        first = 0;
+        freeInput(&inputData);
+        fclose(file);
+    }
+
+    if (useExamples && syntheticSize > 0) { //synthetic inputs of different entropy
+        unsigned char *data = malloc(syntheticSize);
+        if (data == NULL) {
+            fprintf(stderr, "Error allocating memory for the synthetic inputs\n");
+            failed = 1;
+        }
+        for (int profile = 0; profile < 4 && data != NULL; profile++) {
+            generateSynthetic(profile, data, syntheticSize);
+            failed |= benchmarkBuffer(syntheticNames[profile], data, syntheticSize, options, first);
+            first = 0;
+        }
+        free(data);
+    }
+
+    printf("\n]}\n");
+    return failed; //return 0 if every round trip was correct
+}
+
+/*Statistics functions----------------------------------------------------------------------------------------------------*/
+/*clear the statistics before the first call adding to them*/
+void initStats(CodecStats *stats) {
+    memset(stats, 0, sizeof(CodecStats));
+}
+
+/*add the statistics of one thread or call to a total*/
+void addStats(CodecStats *total, const CodecStats *stats) {
+    for (int phase = 0; phase < NUMBER_PHASES; phase++) {
+        total->phases[phase].seconds += stats->phases[phase].seconds;
+        total->phases[phase].bytes += stats->phases[phase].bytes;
+        total->phases[phase].symbols += stats->phases[phase].symbols;
+    }
+    total->wallSeconds += stats->wallSeconds;
+    total->rawBytes += stats->rawBytes;
+    total->compressedBytes += stats->compressedBytes;
+    for (int mode = 0; mode < NUMBER_BLOCK_MODES; mode++) {
+        total->blocks[mode] += stats->blocks[mode];
+    }
+    total->codedSymbols += stats->codedSymbols;
+    total->countedSymbols += stats->countedSymbols;
+    total->codedBits += stats->codedBits;
+    total->entropyBits += stats->entropyBits;
+}
+
+/*print the statistics as a JSON object, the average code length and the entropy per symbol are null if no bits were counted*/
+void printStats(FILE *file, const CodecStats *stats) {
+    static const char *phaseNames[NUMBER_PHASES] = {"input", "histogram", "tree", "code_table", "choose_mode", "wait", "write_table", "encode", "read_table", "decode", "write_output"};
+    fprintf(file, "{\"wall_seconds\": %.6f, \"raw_bytes\": %llu, \"compressed_bytes\": %llu, ", stats->wallSeconds, stats->rawBytes, stats->compressedBytes);
+    fprintf(file, "\"blocks\": {\"table\": %llu, \"repeat\": %llu, \"raw\": %llu, \"rle\": %llu, \"dictionary\": %llu}, ",
+            stats->blocks[BLOCK_TABLE], stats->blocks[BLOCK_REPEAT], stats->blocks[BLOCK_RAW], stats->blocks[BLOCK_RLE], stats->blocks[BLOCK_DICTIONARY]);
+    fprintf(file, "\"coded_symbols\": %llu, \"counted_symbols\": %llu, \"coded_bits\": %llu, \"entropy_bits\": %.1f, ",
+            stats->codedSymbols, stats->countedSymbols, stats->codedBits, stats->entropyBits);
+    if (stats->countedSymbols > 0 && stats->codedBits > 0) { //bits per symbol achieved by the codes and the lower bound given by the entropy
+        fprintf(file, "\"average_code_length\": %.4f, \"entropy_per_symbol\": %.4f, ",
+                (double)stats->codedBits / (double)stats->countedSymbols, stats->entropyBits / (double)stats->countedSymbols);
+    }
+    else {
+        fprintf(file, "\"average_code_length\": null, \"entropy_per_symbol\": null, ");
+    }
+    fprintf(file, "\"phases\": {");
+    for (int phase = 0; phase < NUMBER_PHASES; phase++) {
+        fprintf(file, "%s\n    \"%s\": {\"seconds\": %.6f, \"bytes\": %llu, \"symbols\": %llu}", phase == 0 ? "" : ",", phaseNames[phase],
+                stats->phases[phase].seconds, stats->phases[phase].bytes, stats->phases[phase].symbols);
+    }
+    fprintf(file, "\n}}\n");
+}
+
+#ifdef HUFFMAN_STATS
+/*count the time since the last lap of timer for a phase, with the bytes and symbols it handled, and start the next lap*/
+void lapStats(CodecStats *stats, int phase, double *timer, unsigned long long bytes, unsigned long long symbols) {
+    if (stats == NULL) { //the timer was not started either
+        return;
+    }
+    double now = currentSeconds();
+    stats->phases[phase].seconds += now - *timer;
+    stats->phases[phase].bytes += bytes;
+    stats->phases[phase].symbols += symbols;
+    *timer = now;
+}
+
+/*count the time of a whole call that started at start*/
+void finishStats(CodecStats *stats, double start) {
+    if (stats != NULL) {
+        stats->wallSeconds += currentSeconds() - start;
+    }
+}
+
+/*count an encoded block: its mode, its size, and for coded blocks the bits of their codes and the entropy of their characters*/
+void recordEncodedBlock(CodecStats *stats, const BlockFormat *format, const BlockPlan *plan, size_t length, size_t compressedLength) {
+    if (stats == NULL) {
+        return;
+    }
+    unsigned char frame[COMPACT_FRAME_HEADER_SIZE]; //room for both kinds of frame headers
+    stats->blocks[plan->mode]++;
+    stats->rawBytes += length;
+    stats->compressedBytes += writeFrameHeader(frame, length, compressedLength, format) + compressedLength;
+    if (plan->mode == BLOCK_RAW || plan->mode == BLOCK_RLE) { //raw and RLE blocks have no codes
+        return;
+    }
+    stats->codedSymbols += length;
+    stats->countedSymbols += length;
+    for (int i = 0; i < ASCII_SIZE; ++i) {
+        int frequency = plan->frequency[i].frequency;
+        if (frequency == 0) {
+            continue;
+        }
+        stats->codedBits += (unsigned long long)frequency * plan->codeTable[i].length;
+        stats->entropyBits += frequency * log2((double)length / frequency); //every occurrence needs at least -log2 of the probability of the character
+    }
+}
+
+/*count a decoded block: its mode and its size*/
+void recordDecodedBlock(CodecStats *stats, const BlockFormat *format, int mode, size_t rawLength, size_t compressedLength) {
+    if (stats == NULL) {
+        return;
+    }
+    unsigned char frame[COMPACT_FRAME_HEADER_SIZE]; //room for both kinds of frame headers
+    stats->blocks[mode]++;
+    stats->rawBytes += rawLength;
+    stats->compressedBytes += writeFrameHeader(frame, rawLength, compressedLength, format) + compressedLength;
+    if (mode != BLOCK_RAW && mode != BLOCK_RLE) {
+        stats->codedSymbols += rawLength;
+    }
+}
+#endif
+
+/*Container header and dictionary functions-------------------------------------------------------------------------------*/
+/*write the container header into header, followed by the dictionary ID if a dictionary is used, returns its length*/
+size_t writeContainerHeader(unsigned char *header, size_t blockSize, const BlockFormat *format) {
+    header[0] = HEADER_MAGIC[0];
+    header[1] = HEADER_MAGIC[1];
+    header[2] = FORMAT_VERSION;
+    header[3] = (format->dictionary != NULL ? HEADER_FLAG_DICTIONARY : 0) | (format->numberStreams == INTERLEAVED_STREAMS ? HEADER_FLAG_INTERLEAVED : 0); //flags
+    putU32(header + 4, (unsigned int)blockSize);
+    if (format->dictionary == NULL) {
+        return CONTAINER_HEADER_SIZE;
+    }
+    putU32(header + CONTAINER_HEADER_SIZE, format->dictionary->id); //the decoder has to be given the same dictionary
+    return CONTAINER_HEADER_SIZE + DICTIONARY_ID_SIZE;
+}
+
+/*get the length of a container header from its first CONTAINER_HEADER_SIZE bytes*/
+size_t containerHeaderLength(const unsigned char *header) {
+    return CONTAINER_HEADER_SIZE + ((header[3] & HEADER_FLAG_DICTIONARY) ? DICTIONARY_ID_SIZE : 0);
+}
+
+/*check a whole container header, gives the block size and the format of the blocks*/
+int readContainerHeader(const unsigned char *header, const Dictionary *dictionary, size_t *blockSize, BlockFormat *format) {
+    if (header[0] != HEADER_MAGIC[0] || header[1] != HEADER_MAGIC[1] || header[2] != FORMAT_VERSION || (header[3] & ~(HEADER_FLAG_DICTIONARY | HEADER_FLAG_INTERLEAVED)) != 0) {
+        fprintf(stderr, "Unsupported file format, the file was not compressed by this version of the program\n");
+        return 1; //return 1 on error
+    }
+    *blockSize = getU32(header + 4);
+    if (*blockSize == 0 || *blockSize > MAX_BLOCK_SIZE) {
+        fprintf(stderr, "Compressed file is corrupted\n");
+        return 1;
+    }
+    format->numberStreams = (header[3] & HEADER_FLAG_INTERLEAVED) ? INTERLEAVED_STREAMS : 1;
+    format->dictionary = NULL;
+    if (header[3] & HEADER_FLAG_DICTIONARY) { //blocks may be coded with the dictionary with this ID, so it is needed
+        unsigned int id = getU32(header + CONTAINER_HEADER_SIZE);
+        if (dictionary == NULL || dictionary->id != id) {
+            fprintf(stderr, "The file was compressed with dictionary %08x, pass it with -D\n", id);
+            return 1;
+        }
+        format->dictionary = dictionary;
+    }
+    return 0; //return 0 on success
+}
+
+/*write the frame header of a block into frame, returns its length*/
+size_t writeFrameHeader(unsigned char *frame, size_t rawLength, size_t compressedLength, const BlockFormat *format) {
+    //Files with a dictionary hold small inputs, so their frames store both lengths as varints of 7 bits per byte,
+    //the lowest bits first and the top bit set in every byte but the last. Other files keep two 32 bit lengths.
+    if (format->dictionary == NULL) {
+        putU32(frame, (unsigned int)rawLength);
+        putU32(frame + 4, (unsigned int)compressedLength);
+        return FRAME_HEADER_SIZE;
+    }
+    size_t length = 0;
+    size_t values[2] = {rawLength, compressedLength};
+    for (int i = 0; i < 2; i++) {
+        while (values[i] >= 0x80) {
+            frame[length++] = (unsigned char)(values[i] | 0x80);
+            values[i] >>= 7;
+        }
+        frame[length++] = (unsigned char)values[i];
+    }
+    return length;
+}
+
+/*read a frame header written by writeFrameHeader, returns its length, 0 if data does not start with a whole valid one*/
+size_t readFrameHeader(const unsigned char *data, size_t length, const BlockFormat *format, size_t *rawLength, size_t *compressedLength) {
+    if (format->dictionary == NULL) {
+        if (length < FRAME_HEADER_SIZE) {
+            return 0;
+        }
+        *rawLength = getU32(data);
+        *compressedLength = getU32(data + 4);
+        return FRAME_HEADER_SIZE;
+    }
+    size_t position = 0;
+    size_t *values[2] = {rawLength, compressedLength};
+    for (int i = 0; i < 2; i++) {
+        unsigned long long value = 0;
+        int shift = 0;
+        do {
+            if (position == length || shift > 28) { //the header goes on, or the length has more than 32 bits
+                return 0;
+            }
+            value |= (unsigned long long)(data[position] & 0x7F) << shift;
+            shift += 7;
+        } while (data[position++] & 0x80);
+        if (value > 0xFFFFFFFFu) {
+            return 0;
+        }
+        *values[i] = (size_t)value;
+    }
+    return position;
+}
+
+/*train a dictionary from the frequencies of sample files*/
+int trainDictionary(const char **inputNames, int numberInputs, int maxCodeLength, Dictionary *dictionary) {
+    //The samples are counted with countFrequencies and the tree is built with buildHuffmanTree, like a block.
+    //Every character gets a frequency of at least 1, so the dictionary can code characters that do not occur in the samples.
+    initArena(&dictionary->arena, ARENA_SIZE);
+    unsigned long long totals[ASCII_SIZE] = {0}; //frequencies of all samples
+    for (int i = 0; i < numberInputs; i++) {
+        FILE *file = fopen(inputNames[i], "rb");
+        InputData inputData;
+        if (file == NULL || loadInput(file, &inputData) != 0) {
+            fprintf(stderr, "Could not read %s\n", inputNames[i]);
+            if (file != NULL) {
+                fclose(file);
+            }
+            return 1; //return 1 on error
+        }
+        Frequency characterFrequency[ASCII_SIZE] = {{0, 0}};
+        size_t position = 0;
+        while (position < inputData.length) { //count in pieces, so the int frequencies cannot overflow
+            size_t length = inputData.length - position < MAX_BLOCK_SIZE ? inputData.length - position : MAX_BLOCK_SIZE;
+            countFrequencies(inputData.data + position, length, characterFrequency);
+            for (int c = 0; c < ASCII_SIZE; c++) {
+                totals[c] += (unsigned long long)characterFrequency[c].frequency;
+                characterFrequency[c].frequency = 0;
+            }
+            position += length;
+        }
+        freeInput(&inputData);
+        fclose(file);
+    }
+
+    unsigned long long sum = 0;
+    for (int c = 0; c < ASCII_SIZE; c++) {
+        sum += totals[c];
+    }
+    int shift = 0; //the frequencies are scaled down until their sum fits into the int values of the tree
+    while ((sum >> shift) + NUMBER_SYMBOLS > (1ULL << 30)) {
+        shift++;
+    }
+    Frequency characterFrequency[ASCII_SIZE];
+    for (int c = 0; c < ASCII_SIZE; c++) {
+        characterFrequency[c].character = (unsigned char)c;
+        characterFrequency[c].frequency = (int)(totals[c] >> shift) + 1;
+    }
+
+    Node tree[2 * NUMBER_SYMBOLS - 1]; //every character is a leaf
+    int size = ASCII_SIZE;
+    buildHuffmanTree(tree, &size, characterFrequency);
+    for (int i = 0; i < NUMBER_SYMBOLS; ++i) {
+        dictionary->codeTable[i].letter = i;
+        dictionary->codeTable[i].code = 0;
+        dictionary->codeTable[i].length = 0;
+    }
+    if (buildCodeTable(tree, size - 1, dictionary->codeTable, maxCodeLength) != 0) {
+        return 1;
+    }
+    return finishDictionary(dictionary);
+}
+
+/*compute the ID and the decode table of a dictionary whose code table is complete*/
+int finishDictionary(Dictionary *dictionary) {
+    unsigned int id = 2166136261u; //FNV-1a hash of the code lengths, the same dictionary always gets the same ID
+    for (int i = 0; i < NUMBER_SYMBOLS; ++i) {
+        id = (id ^ (unsigned int)dictionary->codeTable[i].length) * 16777619u;
+    }
+    dictionary->id = id;
+    resetArena(&dictionary->arena);
+    return buildDecodeTable(dictionary->codeTable, &dictionary->decodeTable, &dictionary->arena);
+}
+
+/*write a dictionary to a file: magic bytes, version, reserved byte, ID, then one byte per code length*/
+int saveDictionary(const Dictionary *dictionary, FILE *file) {
+    unsigned char data[DICTIONARY_HEADER_SIZE + NUMBER_SYMBOLS];
+    data[0] = DICTIONARY_MAGIC[0];
+    data[1] = DICTIONARY_MAGIC[1];
+    data[2] = DICTIONARY_VERSION;
+    data[3] = 0; //reserved
+    putU32(data + 4, dictionary->id);
+    for (int i = 0; i < NUMBER_SYMBOLS; ++i) {
+        data[DICTIONARY_HEADER_SIZE + i] = (unsigned char)dictionary->codeTable[i].length;
+    }
+    if (fwrite(data, 1, sizeof(data), file) != sizeof(data)) {
+        fprintf(stderr, "Error writing the dictionary\n");
+        return 1; //return 1 on error
+    }
+    return 0; //return 0 on success
+}
+
+/*read a dictionary written by saveDictionary*/
+int loadDictionary(FILE *file, Dictionary *dictionary) {
+    initArena(&dictionary->arena, ARENA_SIZE);
+    unsigned char data[DICTIONARY_HEADER_SIZE + NUMBER_SYMBOLS];
+    if (fread(data, 1, sizeof(data), file) != sizeof(data) || data[0] != DICTIONARY_MAGIC[0] || data[1] != DICTIONARY_MAGIC[1] || data[2] != DICTIONARY_VERSION) {
+        fprintf(stderr, "Not a dictionary of this version of the program\n");
+        return 1; //return 1 on error
+    }
+    for (int i = 0; i < NUMBER_SYMBOLS; ++i) {
+        dictionary->codeTable[i].letter = i;
+        dictionary->codeTable[i].code = 0;
+        dictionary->codeTable[i].length = data[DICTIONARY_HEADER_SIZE + i];
+        if (dictionary->codeTable[i].length < 1 || dictionary->codeTable[i].length > MAX_CODE_LENGTH) { //every symbol needs a code
+            fprintf(stderr, "Dictionary is corrupted\n");
+            return 1;
+        }
+    }
+    if (assignCanonicalCodes(dictionary->codeTable) != 0 || finishDictionary(dictionary) != 0) {
+        return 1;
+    }
+    if (dictionary->id != getU32(data + 4)) { //the ID is the hash of the lengths, so it also detects damaged lengths
+        fprintf(stderr, "Dictionary is corrupted\n");
+        return 1;
+    }
+    return 0; //return 0 on success
+}
+
+/*free the memory of a dictionary*/
+void freeDictionary(Dictionary *dictionary) {
+    freeArena(&dictionary->arena);
+}
+
+/*Functions required for block parallel coding--------------------------------------------------------------------------------*/
+/*compress one block of the input into a byte buffer, in the block mode that gives the smallest output*/
+int compressBlock(const unsigned char *data, size_t length, int maxCodeLength, const BlockFormat *format, size_t blockIndex, TableReference *reference, Arena *arena, ByteBuffer *output, CodecStats *stats) {
+    BlockPlan plan;
+    if (planBlock(data, length, maxCodeLength, format, arena, &plan, stats) != 0) {
+        return 1; //return 1 on error
+    }
+    STATS_TIMER(stats, timer);
+    if (chooseBlockMode(&plan, length, format, blockIndex, reference, arena) != 0) {
+        return 1;
+    }
+    STATS_LAP(stats, PHASE_CHOOSE_MODE, timer, 0, 0);
+    return encodeBlock(data, length, format, &plan, output, stats); //return 0 on success, the tables stay in the arena until the next block
+}
+
+/*count the characters of a block and build its own code table, the block mode is chosen afterwards*/
+int planBlock(const unsigned char *data, size_t length, int maxCodeLength, const BlockFormat *format, Arena *arena, BlockPlan *plan, CodecStats *stats) {
+    //Blocks are counted with a dictionary too, the dictionary was trained on other data and a block may come out smaller with its own table.
+    //Building that table takes longer than counting, so it is skipped when even the entropy of the block and its table cannot beat the dictionary.
+    STATS_TIMER(stats, timer);
+    resetArena(arena); //the tables of the previous block are not needed anymore
+    plan->frequency = NULL;
+    plan->codeTable = NULL;
+    plan->ownTable = NULL;
+    plan->mode = BLOCK_RAW;
+    plan->owner = -1;
+    plan->frequency = arenaAlloc(arena, ASCII_SIZE * sizeof(Frequency)); //array of frequencies. struct Frequency is defined in types.h
+    if (plan->frequency == NULL) {
+        return 1; //return 1 on error
+    }
+    memset(plan->frequency, 0, ASCII_SIZE * sizeof(Frequency)); //countFrequencies adds to the counts
+    countFrequencies(data, length, plan->frequency); //count the frequency of each character in the block, the sizes of all modes follow from it
+    plan->numberCharacters = countNonZero(plan->frequency, ASCII_SIZE);
+    STATS_LAP(stats, PHASE_HISTOGRAM, timer, length, length);
+    if (plan->numberCharacters <= 1) { //a single character needs no codes
+        return 0;
+    }
+    if (format->dictionary != NULL && encodedSize(plan->frequency, format->dictionary->codeTable, format->numberStreams) <= ownTableBound(plan->frequency, length, format->numberStreams)) {
+        return 0; //chooseBlockMode leaves out the own table
+    }
+    plan->ownTable = buildBlockCodeTable(plan->frequency, plan->numberCharacters, maxCodeLength, arena, stats);
+    if (plan->ownTable == NULL) {
+        return 1;
+    }
+    return 0; //return 0 on success
+}
+
+/*choose the block mode with the smallest output, and update the table reference for the next block*/
+int chooseBlockMode(BlockPlan *plan, size_t length, const BlockFormat *format, size_t blockIndex, TableReference *reference, Arena *arena) {
+    //The sizes are computed from the frequencies without coding the block. On a tie the mode that decodes faster wins,
+    //so a block is only coded if that makes it smaller, and incompressible blocks skip the encoder and decoder entirely.
+    if (plan->numberCharacters == 1) { //the character is stored once, the frame holds the number of repeats
+        plan->mode = BLOCK_RLE;
+        return 0;
+    }
+    long long best = (long long)length; //size of the block stored raw
+    plan->mode = BLOCK_RAW;
+    if (format->dictionary != NULL) { //the dictionary has a code for every character and costs no table
+        long long size = encodedSize(plan->frequency, format->dictionary->codeTable, format->numberStreams);
+        if (size < best) {
+            best = size;
+            plan->mode = BLOCK_DICTIONARY;
+            plan->codeTable = format->dictionary->codeTable;
+        }
+    }
+    if (reference != NULL && reference->owner >= 0 && blockIndex <= 0xFFFFFFFFu) { //the table of an earlier block may fit this block too
+        long long size = encodedSize(plan->frequency, reference->codeTable, format->numberStreams);
+        if (size >= 0 && size + BLOCK_OWNER_SIZE < best) { //every character of the block needs a code in the reused table
+            best = size + BLOCK_OWNER_SIZE;
+            plan->mode = BLOCK_REPEAT;
+        }
+    }
+    const Code *ownTable = plan->ownTable;
+    if (ownTable != NULL && encodedSize(plan->frequency, ownTable, format->numberStreams) + (long long)codeTableSize(ownTable) < best) { //a new table is stored in the block
+        plan->mode = BLOCK_TABLE;
+    }
+
+    if (plan->mode == BLOCK_TABLE) {
+        plan->codeTable = ownTable;
+        if (reference != NULL) { //the following blocks may reuse this table
+            memcpy(reference->codeTable, ownTable, sizeof(reference->codeTable));
+            reference->owner = (long long)blockIndex;
+        }
+    }
+    else if (plan->mode == BLOCK_REPEAT) {
+        Code *codeTable = arenaAlloc(arena, sizeof(reference->codeTable)); //the next block may replace the reference while this one is encoded
+        if (codeTable == NULL) {
+            return 1; //return 1 on error
+        }
+        memcpy(codeTable, reference->codeTable, sizeof(reference->codeTable));
+        plan->codeTable = codeTable;
+        plan->owner = reference->owner;
+    }
+    return 0; //return 0 on success
+}
+
+/*compute the size of the bit streams of a block coded with a code table, -1 if a character of the block has no code in it*/
+long long encodedSize(const Frequency *frequency, const Code *codeTable, int numberStreams) {
+    unsigned long long bits = 0;
+    for (int i = 0; i < ASCII_SIZE; ++i) {
+        if (frequency[i].frequency == 0) {
+            continue;
+        }
+        if (codeTable[i].length == 0) {
+            return -1;
+        }
+        bits += (unsigned long long)frequency[i].frequency * codeTable[i].length;
+    }
+    if (numberStreams == INTERLEAVED_STREAMS) { //jump table, every stream is padded to whole bytes
+        return (long long)(bits / 8 + JUMP_TABLE_SIZE + INTERLEAVED_STREAMS);
+    }
+    return (long long)((bits + 7) / 8); //one stream padded to whole bytes
+}
+
+/*compute a lower bound of the size of a block coded with its own table: the entropy of its characters and the size of the table*/
+long long ownTableBound(const Frequency *frequency, size_t length, int numberStreams) {
+    //No code can take less bits than the entropy. log2 is computed here with a series that stays below it, so the bound holds
+    //and the program needs no math library.
+    double bits = 0;
+    int numberRanges = 0, numberCodes = 0;
+    for (int i = 0; i < ASCII_SIZE; ++i) {
+        if (frequency[i].frequency == 0) {
+            continue;
+        }
+        numberCodes++;
+        if (i == 0 || frequency[i - 1].frequency == 0) { //first character of a range, like in codeTableSize
+            numberRanges++;
+        }
+        double ratio = (double)length / frequency[i].frequency; //the character costs log2(ratio) bits
+        int exponent = 0;
+        while (ratio >= 2) { //exact, leaves the ratio in [1, 2)
+            ratio *= 0.5;
+            exponent++;
+        }
+        double z = (ratio - 1) / (ratio + 1), z2 = z * z; //ln(ratio) = 2 * (z + z^3/3 + z^5/5 + ...) with z <= 1/3, the terms left out are positive
+        double series = z * (1 + z2 * (1.0 / 3 + z2 * (1.0 / 5 + z2 * (1.0 / 7 + z2 * (1.0 / 9)))));
+        bits += frequency[i].frequency * (exponent + 2 * series * 1.4426950408889634); //log2(e)
+    }
+    long long size = (long long)(bits * (1 - 1e-9) / 8); //rounded down, with room for rounding errors of the sum
+    if (numberStreams == INTERLEAVED_STREAMS) {
+        size += JUMP_TABLE_SIZE;
+    }
+    return size + 1 + 2 * (long long)numberRanges + ((long long)numberCodes * LENGTH_BITS + 7) / 8;
+}
+
+/*compute the number of bytes writeCodeTable2Buffer writes for a code table*/
+size_t codeTableSize(const Code *codeTable) {
+    int numberRanges = 0, numberCodes = 0;
+    for (int i = 0; i < NUMBER_SYMBOLS; ++i) {
+        if (codeTable[i].length == 0) {
+            continue;
+        }
+        numberCodes++;
+        if (i == 0 || codeTable[i - 1].length == 0) { //first character of a range
+            numberRanges++;
+        }
+    }
+    return 1 + 2 * (size_t)numberRanges + ((size_t)numberCodes * LENGTH_BITS + 7) / 8;
+}
+
+/*write a block in the mode chosen for it: the mode, then the block in that mode*/
+int encodeBlock(const unsigned char *data, size_t length, const BlockFormat *format, const BlockPlan *plan, ByteBuffer *output, CodecStats *stats) {
+    STATS_TIMER(stats, timer);
+    output->length = 0;
+    unsigned char header[1 + BLOCK_OWNER_SIZE];
+    size_t headerLength = 1;
+    header[0] = (unsigned char)plan->mode;
+    if (plan->mode == BLOCK_REPEAT) { //index of the block holding the table
+        putU32(header + 1, (unsigned int)plan->owner);
+        headerLength += BLOCK_OWNER_SIZE;
+    }
+    if (appendByteBuffer(output, header, headerLength) != 0) {
+        return 1; //return 1 on error
+    }
+    if (plan->mode == BLOCK_TABLE && writeCodeTable2Buffer(output, plan->ownTable) != 0) { //write the code lengths into the header of the block
+        return 1;
+    }
+    size_t tableEnd = output->length; //end of the mode and the code table
+    STATS_LAP(stats, PHASE_WRITE_TABLE, timer, tableEnd, 0);
+
+    int result = 0;
+    const Code *codeTable = plan->codeTable;
+    if (plan->mode == BLOCK_RAW) {
+        result = appendByteBuffer(output, data, length);
+    }
+    else if (plan->mode == BLOCK_RLE) {
+        result = appendByteBuffer(output, data, 1);
+    }
+    else if (format->numberStreams == INTERLEAVED_STREAMS) {
+        result = encodeInterleaved(data, length, codeTable, output);
+    }
+    else {
+        BitWriter writer; //collects the codes and moves them to the output buffer in whole words
+        initBitWriter(&writer, output);
+        for (size_t i = 0; i < length && result == 0; i++) { //encode the block character by character
+            unsigned char c = data[i];
+            result = writeBits(&writer, codeTable[c].code, codeTable[c].length); //append the code of the character to the output
+        }
+        if (result == 0) {
+            result = flushBitWriter(&writer); //move the remaining bits, the last byte is padded with zeros
+        }
+    }
+    STATS_LAP(stats, PHASE_ENCODE, timer, output->length - tableEnd, plan->mode != BLOCK_RAW && plan->mode != BLOCK_RLE ? length : 0);
+    STATS_CALL(recordEncodedBlock(stats, format, plan, length, output->length));
+
+    return result; //return 0 on success
+}
+
+/*encode a block as INTERLEAVED_STREAMS bit streams of consecutive parts of the block, behind a jump table with their sizes*/
+int encodeInterleaved(const unsigned char *data, size_t length, const Code *codeTable, ByteBuffer *output) {
+    //Stream s holds the characters from s * part to (s + 1) * part. The number of characters of every stream follows from the block length,
+    //like for single streams. Every stream is padded to whole bytes, so the decoder can start all of them at once.
+    size_t jumpTable = output->length; //position of the jump table, filled in once the sizes are known
+    unsigned char sizes[JUMP_TABLE_SIZE] = {0};
+    if (appendByteBuffer(output, sizes, JUMP_TABLE_SIZE) != 0) {
+        return 1; //return 1 on error
+    }
+    size_t part = (length + INTERLEAVED_STREAMS - 1) / INTERLEAVED_STREAMS; //number of characters per stream, the last one may have less
+    for (int stream = 0; stream < INTERLEAVED_STREAMS; stream++) {
+        size_t start = stream * part < length ? stream * part : length;
+        size_t end = start + part < length ? start + part : length;
+        size_t streamStart = output->length;
+        BitWriter writer;
+        initBitWriter(&writer, output);
+        int result = 0;
+        for (size_t i = start; i < end && result == 0; i++) {
+            result = writeBits(&writer, codeTable[data[i]].code, codeTable[data[i]].length);
+        }
+        if (result != 0 || flushBitWriter(&writer) != 0) {
+            return 1;
+        }
+        if (output->length - streamStart > 0xFFFFFFFFu) { //cannot happen with blocks of at most MAX_BLOCK_SIZE
+            return 1;
+        }
+        if (stream < INTERLEAVED_STREAMS - 1) { //the size of the last stream is what is left of the block
+            putU32(output->data + jumpTable + 4 * stream, (unsigned int)(output->length - streamStart));
+        }
+    }
+    return 0; //return 0 on success
+}
+
+/*build the code table of one block from the frequencies of its size different characters, returns NULL on error*/
+Code *buildBlockCodeTable(Frequency *characterFrequency0, int size, int maxCodeLength, Arena *arena, CodecStats *stats) {
+    STATS_TIMER(stats, timer);
+    int numberLeaves = size; //size becomes the number of nodes of the tree
+    Frequency *characterFrequency = removeZeroElements(characterFrequency0, size, arena); //remove all elements with a frequency of 0 from the array
+
+    Node* tree = arenaAlloc(arena, sizeof(Node) * (2*size-1)); //memory for the whole Huffman tree at once, a tree with n leaves has 2n-1 nodes
+    Code *codeTable = arenaAlloc(arena, NUMBER_SYMBOLS * sizeof(Code)); //code table, one entry per symbol
+    if (characterFrequency == NULL || tree == NULL || codeTable == NULL) {
+        return NULL; //return NULL on error
+    }
+    tree = buildHuffmanTree(tree, &size, characterFrequency); //build the Huffman tree and return its address
+    STATS_LAP(stats, PHASE_TREE, timer, 0, numberLeaves);
+
+    for (int i = 0; i < NUMBER_SYMBOLS; ++i) { //initialise code table
+        codeTable[i].letter = i;
+        codeTable[i].code = 0;
+        codeTable[i].length = 0; //length 0 marks symbols that do not occur
+    }
+    if (buildCodeTable(tree, size-1, codeTable, maxCodeLength) != 0) { //build the canonical code table
+        return NULL;
+    }
+    STATS_LAP(stats, PHASE_CODE_TABLE, timer, 0, numberLeaves);
+    return codeTable;
+}
+
+/*decompress one block into a byte buffer, reference holds the last code table stored in a block and is updated by blocks storing one*/
+int decompressBlock(const unsigned char *data, size_t length, size_t rawLength, size_t blockIndex, const BlockFormat *format, TableReference *reference, Arena *arena, ByteBuffer *output, CodecStats *stats) {
+    STATS_TIMER(stats, timer);
+    output->length = 0;
+    resetArena(arena); //the tables of the previous block are not needed anymore
+    if (reserveByteBuffer(output, rawLength) != 0) { //the uncompressed length is known from the frame
+        return 1; //return 1 on error
+    }
+    int mode = length > 0 ? data[0] : -1;
+    size_t position = 1; //position after the mode, then of the bit stream after the code table
+
+    if (mode == BLOCK_RAW && length - 1 == rawLength) { //stored as it is
+        memcpy(output->data, data + 1, rawLength);
+        output->length = rawLength;
+        STATS_LAP(stats, PHASE_DECODE, timer, rawLength, 0);
+        STATS_CALL(recordDecodedBlock(stats, format, mode, rawLength, length));
+        return 0;
+    }
+    if (mode == BLOCK_RLE && length == 2) { //a single repeated character
+        memset(output->data, data[1], rawLength);
+        output->length = rawLength;
+        STATS_LAP(stats, PHASE_DECODE, timer, rawLength, 0);
+        STATS_CALL(recordDecodedBlock(stats, format, mode, rawLength, length));
+        return 0;
+    }
+
+    DecodeTable blockTable;
+    const DecodeTable *decodeTable = &blockTable;
+    Code *codeTable = NULL;
+    if (mode == BLOCK_DICTIONARY && format->dictionary != NULL) { //the block has no code table, the decode table of the dictionary is ready
+        decodeTable = &format->dictionary->decodeTable;
+    }
+    else if (mode == BLOCK_TABLE) {
+        int tableSize = 0;
+        codeTable = reconstructCodeTableFromBuffer(data, length, &position, &tableSize, arena); //reconstruct code table from the block header
+        if (codeTable != NULL && reference != NULL) { //later blocks may reuse the table
+            memcpy(reference->codeTable, codeTable, sizeof(reference->codeTable));
+            reference->owner = (long long)blockIndex;
+        }
+    }
+    else if (mode == BLOCK_REPEAT && length >= 1 + BLOCK_OWNER_SIZE && reference != NULL
+             && reference->owner >= 0 && (long long)getU32(data + 1) == reference->owner && (size_t)reference->owner < blockIndex) { //the caller loaded the table of the block named in this one
+        codeTable = reference->codeTable;
+        position += BLOCK_OWNER_SIZE;
+    }
+    if (decodeTable == &blockTable && (codeTable == NULL || buildDecodeTable(codeTable, &blockTable, arena) != 0)) { //build the lookup table once from the code table
+        fprintf(stderr, "Compressed block is corrupted\n");
+        return 1;
+    }
+    STATS_LAP(stats, PHASE_READ_TABLE, timer, position, 0);
+
+    int valid;
+    if (format->numberStreams == INTERLEAVED_STREAMS) {
+        valid = decodeInterleaved(data + position, length - position, output->data, rawLength, decodeTable) == 0;
+    }
+    else {
+        valid = decodeBinaryBlock(data + position, length - position, output->data, rawLength, decodeTable) == 0; //decode the bit stream following the code table
+    }
+    if (!valid) { //the block has to decode to exactly the length stored in its frame
+        fprintf(stderr, "Compressed block is corrupted\n");
+        return 1;
+    }
+    output->length = rawLength;
+    STATS_LAP(stats, PHASE_DECODE, timer, rawLength, rawLength);
+    STATS_CALL(recordDecodedBlock(stats, format, mode, rawLength, length));
+    return 0; //return 0 on success
+}
+
+/*read the code table stored in block owner into reference, data holds length bytes of the block, its start with the table is enough*/
+int loadTableReference(const unsigned char *data, size_t length, size_t owner, TableReference *reference, Arena *arena) {
+    if (length < 1 || data[0] != BLOCK_TABLE) { //only blocks storing a table can be reused
+        fprintf(stderr, "Compressed block is corrupted\n");
+        return 1; //return 1 on error
+    }
+    resetArena(arena);
+    size_t position = 1;
+    int tableSize = 0;
+    Code *codeTable = reconstructCodeTableFromBuffer(data, length, &position, &tableSize, arena);
+    if (codeTable == NULL) {
+        return 1;
+    }
+    memcpy(reference->codeTable, codeTable, sizeof(reference->codeTable));
+    reference->owner = (long long)owner;
+    return 0; //return 0 on success
+}
 
-    printf("Only .txt files are supported for compression and .bin files for decompression. Please ensure that the entered file path is no longer than 100 characters.\n"); //explain to user what to do
-    printf("The output file will be named output.bin for compression and output.txt for decompression. It will appear in the same directory as the input file.\n"); //explain to user what to do
-    printf("Type the name of the file to process:");
-    scanf("%s",filename); //get filename (or path) from user
+/*code the blocks of a pool on worker threads and write the results in order*/
+int runBlockPool(BlockPool *pool, FILE *output, unsigned long long *blockOffsets, unsigned long long *position, int numberThreads) {
+    //Workers take the next block, code it into the slot of that block and signal it. This thread writes the slots in block order.
+    //A worker only takes a block while its slot is free, so at most window blocks are held in memory.
+    if (numberThreads < 1) {
+        numberThreads = 1;
+    }
+    if (numberThreads > MAX_THREADS) {
+        numberThreads = MAX_THREADS;
+    }
+    pool->window = (size_t)numberThreads * BLOCKS_PER_THREAD;
+    pool->nextBlock = 0;
+    pool->writtenBlocks = 0;
+    pool->decidedBlocks = 0;
+    pool->reference.owner = -1; //the first block cannot reuse a table
+    pool->failed = 0;
+    pool->results = malloc(pool->window * sizeof(ByteBuffer));
+    pool->resultReady = calloc(pool->window, sizeof(int));
+    Thread *threads = malloc(numberThreads * sizeof(Thread));
+    if (pool->results == NULL || pool->resultReady == NULL || threads == NULL) {
+        fprintf(stderr, "Error allocating memory for the thread pool\n");
+        free(pool->results);
+        free(pool->resultReady);
+        free(threads);
+        return 1; //return 1 on error
+    }
+    for (size_t slot = 0; slot < pool->window; slot++) {
+        initByteBuffer(&pool->results[slot]);
+    }
+    initMutex(&pool->mutex);
+    initCondition(&pool->condition);
+    CodecStats writerStats; //time spent writing, added to the statistics of the pool once the workers are done
+    initStats(&writerStats);
+    CodecStats *stats = pool->stats != NULL ? &writerStats : NULL;
 
-    if (strlen(filename)>100){ //check the length of the filename/filepath
-        printf("Filename too long. Please try again.");
-        exit(1); //exit the program if filename too long
+    int startedThreads = 0;
+    while (startedThreads < numberThreads && startThread(&threads[startedThreads], blockWorker, pool) == 0) { //start the workers
+        startedThreads++;
+    }
+    if (startedThreads == 0) { //without any worker no block would ever be coded
+        fprintf(stderr, "Error starting worker threads\n");
+        pool->failed = 1;
     }
-    int compress = getFileType(filename); //check if file is .txt or .bin, returns 1 for .txt, 2 for .bin, 0 for unknown file type
 
-    switch (compress) { //switch between compression and decompression dependent on file type
-        case 1: //if .txt file -> compress
-            input = fopen(filename, "r"); //open input file in read mode
-            output = fopen("output.bin", "wb"); //open output file in binary write mode
-            compressFile(input, output); //call compress function
-            printf("\n-----------------------------Compression complete-----------------------------\n");
-            break; //break out of switch statement
-        case 2: //if .bin file -> decompress
-            input = fopen(filename, "rb"); //open input file in binary read mode
-            output = fopen("output.txt", "w"); //open output file in write mode
-            decompressFile(input, output); //call decompress function
-            printf("\n-----------------------------Decompression complete-----------------------------\n");
+    for (size_t block = 0; block < pool->blockCount; block++) { //write the blocks in order as soon as they are ready
+        size_t slot = block % pool->window;
+        lockMutex(&pool->mutex);
+        while (!pool->resultReady[slot] && !pool->failed) { //wait for the worker coding this block
+            waitCondition(&pool->condition, &pool->mutex);
+        }
+        int failed = pool->failed;
+        unlockMutex(&pool->mutex);
+        if (failed) {
             break;
-        default: //if unknown file type -> error message
-            printf("Invalid input. Please use either a .txt or a .bin file\n");
-            break; //break out of switch statement
+        }
+
+        STATS_TIMER(stats, timer);
+        ByteBuffer *result = &pool->results[slot];
+        size_t frameLength = 0;
+        if (pool->compress) { //write the frame: uncompressed length, compressed length and the compressed block
+            size_t start = block * pool->blockSize;
+            size_t rawLength = pool->inputLength - start < pool->blockSize ? pool->inputLength - start : pool->blockSize;
+            unsigned char frame[COMPACT_FRAME_HEADER_SIZE];
+            frameLength = writeFrameHeader(frame, rawLength, result->length, &pool->format);
+            blockOffsets[block] = *position; //remember where the frame starts for the index
+            fwrite(frame, sizeof(unsigned char), frameLength, output);
+            *position += frameLength;
+        }
+        if (fwrite(result->data, sizeof(unsigned char), result->length, output) != result->length) {
+            fprintf(stderr, "Error writing the output\n");
+            lockMutex(&pool->mutex);
+            pool->failed = 1;
+            unlockMutex(&pool->mutex);
+        }
+        *position += result->length;
+        STATS_LAP(stats, PHASE_WRITE_OUTPUT, timer, result->length + frameLength, 0);
+
+        lockMutex(&pool->mutex);
+        pool->resultReady[slot] = 0; //the slot can take the next block
+        pool->writtenBlocks++;
+        broadcastCondition(&pool->condition);
+        unlockMutex(&pool->mutex);
     }
 
-    fclose(input); //close input file
-    fclose(output); //close output file
+    lockMutex(&pool->mutex);
+    if (pool->writtenBlocks < pool->blockCount) { //stop the workers if a block failed
+        pool->failed = 1;
+    }
+    broadcastCondition(&pool->condition);
+    unlockMutex(&pool->mutex);
+    for (int i = 0; i < startedThreads; i++) { //wait for all workers to finish
+        joinThread(threads[i]);
+    }
+    if (stats != NULL) {
+        addStats(pool->stats, stats);
+    }
 
-    return 0; //return 0 to indicate successful execution
+    int result = pool->failed;
+    for (size_t slot = 0; slot < pool->window; slot++) {
+        freeByteBuffer(&pool->results[slot]);
+    }
+    destroyCondition(&pool->condition);
+    destroyMutex(&pool->mutex);
+    free(pool->results);
+    free(pool->resultReady);
+    free(threads);
+    return result; //return 0 on success
 }
 
-/*Compress and Decompress function definitions--------------------------------------------------------------------------*/
-/*function to compress the input .txt file and give out a binary output file*/
-void compressFile(FILE *input, FILE *output){
-    printf("Compressing file");
-    printf("\n");
+/*function run by every worker thread of a block pool*/
+void *blockWorker(void *argument) {
+    BlockPool *pool = argument;
+    Arena arena; //tables of the block being coded, reused for every block of this worker
+    initArena(&arena, ARENA_SIZE);
+    TableReference reference; //last table this worker loaded for blocks reusing it, only used to decompress
+    reference.owner = -1;
+    CodecStats workerStats; //statistics of this worker, added to those of the pool at the end so workers do not share counters
+    initStats(&workerStats);
+    CodecStats *stats = pool->stats != NULL ? &workerStats : NULL;
 
-    Frequency *characterFrequency0 = (Frequency *)calloc(ASCII_SIZE, sizeof(Frequency)); //allocate memory for array of frequencies. struct Frequency is defined in types.h
-    countFrequencies(input, characterFrequency0); //count the frequency of each character in the input file
-    int size = countNonZero(characterFrequency0, ASCII_SIZE); //count the number of non-zero elements in the array, size becomes very important later on
-    Frequency *characterFrequency = removeZeroElements(characterFrequency0, size); //remove all elements with a frequency of 0 from the array
+    lockMutex(&pool->mutex);
+    while (1) {
+        while (!pool->failed && pool->nextBlock < pool->blockCount && pool->nextBlock >= pool->writtenBlocks + pool->window) { //wait until the slot of the next block is free
+            waitCondition(&pool->condition, &pool->mutex);
+        }
+        if (pool->failed || pool->nextBlock >= pool->blockCount) { //no work left
+            break;
+        }
+        size_t block = pool->nextBlock++; //take the next block
+        unlockMutex(&pool->mutex);
 
-    Node* tree = malloc(sizeof(Node) * (size+1)); //allocate memory for the Huffman tree, size+1 to asccount for EOF character
-    int NumberLeafNodes;
-    memcpy(&NumberLeafNodes, &size, sizeof(int)); //copy the value of size into NumberLeafNodes, used to reconstruct the tree later on, value of size is changed in buildHuffmanTree function
-    tree = buildHuffmanTree(tree, &size, characterFrequency); //build the Huffman tree and return its address
+        ByteBuffer *result = &pool->results[block % pool->window]; //only this worker touches the slot until it is marked ready
+        int failed;
+        if (pool->compress) {
+            size_t start = block * pool->blockSize;
+            size_t length = pool->inputLength - start < pool->blockSize ? pool->inputLength - start : pool->blockSize;
+            BlockPlan plan; //counting and building the table run in parallel, only the cheap choice of the mode waits for the previous block
+            failed = planBlock(pool->input + start, length, pool->maxCodeLength, &pool->format, &arena, &plan, stats);
+            STATS_TIMER(stats, timer);
+            lockMutex(&pool->mutex);
+            while (!pool->failed && pool->decidedBlocks < block) { //the mode depends on the table reference left by the previous block
+                waitCondition(&pool->condition, &pool->mutex);
+            }
+            STATS_LAP(stats, PHASE_WAIT, timer, 0, 0);
+            failed = failed || pool->failed || chooseBlockMode(&plan, length, &pool->format, block, &pool->reference, &arena) != 0;
+            pool->decidedBlocks = block + 1;
+            broadcastCondition(&pool->condition);
+            unlockMutex(&pool->mutex);
+            STATS_LAP(stats, PHASE_CHOOSE_MODE, timer, 0, 0);
+            if (!failed) {
+                failed = encodeBlock(pool->input + start, length, &pool->format, &plan, result, stats);
+            }
+        }
+        else {
+            size_t rawLength, length;
+            const unsigned char *data = poolBlock(pool, block, &rawLength, &length);
+            failed = 0;
+            if (length >= 1 + BLOCK_OWNER_SIZE && data[0] == BLOCK_REPEAT
+                && (long long)getU32(data + 1) != reference.owner) { //the table is stored in an earlier block, which another worker may have decoded
+                STATS_TIMER(stats, timer);
+                size_t owner = getU32(data + 1), ownerRawLength, ownerLength;
+                failed = owner >= block;
+                if (!failed) {
+                    const unsigned char *ownerData = poolBlock(pool, owner, &ownerRawLength, &ownerLength);
+                    failed = loadTableReference(ownerData, ownerLength, owner, &reference, &arena) != 0;
+                }
+                STATS_LAP(stats, PHASE_READ_TABLE, timer, 0, 0);
+            }
+            if (!failed) {
+                failed = decompressBlock(data, length, rawLength, block, &pool->format, &reference, &arena, result, stats);
+            }
+            else {
+                fprintf(stderr, "Compressed block is corrupted\n");
+            }
+        }
 
-    Code *codeTable = malloc(ASCII_SIZE * sizeof(Code)); //allocate memory for the code table
-    for (int i = 0; i < ASCII_SIZE; ++i) { //initialise code table
-        codeTable[i].letter = 0;
-        codeTable[i].code = NULL;
-        codeTable[i].length = 0;
+        lockMutex(&pool->mutex);
+        if (failed) {
+            pool->failed = 1;
+        }
+        pool->resultReady[block % pool->window] = 1;
+        broadcastCondition(&pool->condition); //wake the writing thread
     }
-    char currentCode[ASCII_SIZE] = {0}; //initialise currentCode array to 0
-    buildCodeTable(tree, size-1 , codeTable, currentCode, 0); //build the code table containing character, code and code length for all ASCII characters
-    writeCodeTable2FileBinary(output, codeTable, NumberLeafNodes); //write the codeTable into the header of the output file
-
-    char c;
-    while ((c = fgetc(input)) != EOF) { //read file character by character until EOF is reached
-        writeBinaryString2File(output, c, codeTable, size); //write the binary code of the character to the output file
+    if (stats != NULL) { //still holding the mutex
+        addStats(pool->stats, stats);
     }
-    writeBinaryString2File(output, EOF, codeTable, size); // Write EOF character to the output file when all characters are processed
+    unlockMutex(&pool->mutex);
 
-    // Clean up memory for all variables
-    //free(tree);
-    //for (int i = 0; i < ASCII_SIZE; ++i) {
-    //    free(codeTable[i].code);
-    //}
-    //free(codeTable);
-    free(characterFrequency0); //free memory allocated for characterFrequency0
-    free(characterFrequency); //free memory allocated for characterFrequency
+    freeArena(&arena);
+    return NULL;
+}
 
-    summarizeCompression(input, output); //print compression statistics to terminal: original bits, compressed bits, compression ratio, saved memory
+/*find block b of a pool decompressing a file, gives its lengths from the frame header, which decompressFile checked when it walked the frames*/
+const unsigned char *poolBlock(const BlockPool *pool, size_t b, size_t *rawLength, size_t *compressedLength) {
+    const unsigned char *frame = pool->input + pool->frameOffsets[b];
+    return frame + readFrameHeader(frame, pool->inputLength - pool->frameOffsets[b], &pool->format, rawLength, compressedLength);
+}
 
-    return;
+/*Functions required for reading the input---------------------------------------------------------------------------------*/
+/*get the size of a file that can seek, -1 for pipes and other streams*/
+long long fileSize(FILE *file) {
+#ifdef _WIN32
+    if (_fseeki64(file, 0, SEEK_END) != 0) {
+        return -1;
+    }
+    return _ftelli64(file);
+#else
+    if (fseeko(file, 0, SEEK_END) != 0) { //64 bit positions, so files above 2 GB work
+        return -1;
+    }
+    return (long long)ftello(file);
+#endif
 }
 
-/*function to decompress the input .bin file to a .txt file*/
-void decompressFile(FILE *input, FILE *output) {
-    printf("Decompressing file\n");
-    //reconstruct code table from file
-    int tableSize = 0;
-    Code* codeTable = reconstructCodeTableFromFileBinary(input, &tableSize); //reconstruct code table from binary file
+/*read length bytes at a position of a file that can seek*/
+int readAt(FILE *file, unsigned long long position, void *data, size_t length) {
+#ifdef _WIN32
+    int failed = _fseeki64(file, (long long)position, SEEK_SET) != 0;
+#else
+    int failed = fseeko(file, (off_t)position, SEEK_SET) != 0;
+#endif
+    if (failed || fread(data, 1, length, file) != length) {
+        return 1; //return 1 on error
+    }
+    return 0; //return 0 on success
+}
+
+/*load the whole input file, memory-mapped if it is a regular file, otherwise read in large chunks*/
+int loadInput(FILE *file, InputData *input) {
+    input->data = NULL;
+    input->length = 0;
+    input->mapped = 0;
 
-    decodeBinaryFile(input, output, codeTable, tableSize); //decode the binary string following the code table using the code table
+#ifndef _WIN32
+    struct stat fileStatus;
+    if (fstat(fileno(file), &fileStatus) == 0 && S_ISREG(fileStatus.st_mode) && fileStatus.st_size > 0 && ftell(file) == 0) { //only regular files read from the start can be mapped
+        void *mapping = mmap(NULL, (size_t)fileStatus.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0); //map the whole file, the kernel reads it on demand
+        if (mapping != MAP_FAILED) {
+            madvise(mapping, (size_t)fileStatus.st_size, MADV_SEQUENTIAL); //the file is read front to back twice, let the kernel read ahead
+            input->data = mapping;
+            input->length = (size_t)fileStatus.st_size;
+            input->mapped = 1;
+            return 0; //return 0 on success
+        }
+    }
+#endif
 
-    // Clean up memory for all variables
-        for (int i = 0; i < tableSize; ++i) {
-            free(codeTable[i].code); //free memory allocated for codeTable codes
+    //pipes, stdin and files that cannot be mapped are spooled into memory in large chunks
+    size_t capacity = SPOOL_INITIAL_SIZE;
+    input->data = malloc(capacity);
+    if (input->data == NULL) {
+        fprintf(stderr, "Error allocating memory for the input\n");
+        return 1; //return 1 on error
+    }
+    size_t bytesRead;
+    while ((bytesRead = fread(input->data + input->length, 1, capacity - input->length, file)) > 0) { //fill the free part of the buffer
+        input->length += bytesRead;
+        if (input->length == capacity) { //buffer is full, double its size
+            unsigned char *bigger = realloc(input->data, capacity * 2);
+            if (bigger == NULL) {
+                fprintf(stderr, "Error allocating memory for the input\n");
+                free(input->data);
+                input->data = NULL;
+                return 1;
+            }
+            input->data = bigger;
+            capacity *= 2;
         }
-        free(codeTable); //free memory allocated for codeTable
+    }
+    if (ferror(file)) {
+        fprintf(stderr, "Error reading the input\n");
+        free(input->data);
+        input->data = NULL;
+        return 1;
+    }
+    return 0; //return 0 on success
+}
+
+/*release the memory of a loaded input*/
+void freeInput(InputData *input) {
+#ifndef _WIN32
+    if (input->mapped) {
+        munmap(input->data, input->length);
+        input->data = NULL;
+        return;
+    }
+#endif
+    free(input->data);
+    input->data = NULL;
 }
 
 /*Functions required for compression---------------------------------------------------------------------------------------*/
-/*count the frequency of each character in the input file*/
-void countFrequencies(FILE *file, Frequency *characterFrequency) 
+/*count the frequency of each character in the input data*/
+void countFrequencies(const unsigned char *data, size_t length, Frequency *characterFrequency) 
 {    
-    int c;
-    while ((c = fgetc(file)) != EOF) { //read file character by character until EOF is reached
+    //Repeated characters would increment the same counter back to back, and each increment would have to wait for the previous store.
+    //Consecutive characters go to different count tables instead, so the increments are independent. The tables are added up at the end.
+    //Clearing and adding up the 8 tables only pays off from about 8 KB, so shorter inputs, such as small files, use a single count.
+    if (length < HISTOGRAM_MIN_LENGTH) {
+        countFrequenciesSimple(data, length, characterFrequency);
+        return;
+    }
+    uint32_t counts[HISTOGRAM_LANES][ASCII_SIZE] = {{0}}; //one count table per lane
+    size_t i = 0;
+
+    for (; i + 8 <= length; i += 8) { //read 8 characters with one load, each goes to its own lane
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word)); //unaligned load that compiles to a single instruction
+        counts[0][(unsigned char)word]++;
+        counts[1][(unsigned char)(word >> 8)]++;
+        counts[2][(unsigned char)(word >> 16)]++;
+        counts[3][(unsigned char)(word >> 24)]++;
+        counts[4][(unsigned char)(word >> 32)]++;
+        counts[5][(unsigned char)(word >> 40)]++;
+        counts[6][(unsigned char)(word >> 48)]++;
+        counts[7][(unsigned char)(word >> 56)]++;
+    }
+    for (; i < length; i++) { //count the remaining characters
+        counts[0][data[i]]++;
+    }
+
+    for (int c = 0; c < ASCII_SIZE; c++) { //add up the lanes
+        uint32_t total = 0;
+        for (int lane = 0; lane < HISTOGRAM_LANES; lane++) {
+            total += counts[lane][c];
+        }
+        characterFrequency[c].character = (unsigned char)c; //store the character in the array
+        characterFrequency[c].frequency += total; //add the frequency of the character
+    }
+}
+
+/*count the frequency of each character with a single count per character, faster than the count tables of countFrequencies for short inputs*/
+void countFrequenciesSimple(const unsigned char *data, size_t length, Frequency *characterFrequency) {
+    for (size_t i = 0; i < length; i++) { //go through the input character by character
+        unsigned char c = data[i];
         characterFrequency[c].character = c; //store the character in the array
         characterFrequency[c].frequency++; //increment the frequency of the character
     }
-    rewind(file); //reset file pointer to beginning of file
 }
 
 /*count non-zero elements*/
@@ -143,9 +3011,12 @@ int countNonZero(Frequency *characterFrequency, int size) {
 }
 
 /*replace sorted array with one excluding the zeros*/
-Frequency *removeZeroElements(Frequency *characterFrequency0, int size)
+Frequency *removeZeroElements(Frequency *characterFrequency0, int size, Arena *arena)
 {
-    Frequency *characterFrequency1 = (Frequency *)malloc(size * sizeof(Frequency)); //allocate memory for the new array using size
+    Frequency *characterFrequency1 = arenaAlloc(arena, size * sizeof(Frequency)); //memory for the new array using size
+    if (characterFrequency1 == NULL) {
+        return NULL;
+    }
     int j = 0;
     for (int i = 0; i < ASCII_SIZE; i++) //loop through the old array
     {
@@ -157,27 +3028,53 @@ Frequency *removeZeroElements(Frequency *characterFrequency0, int size)
     return characterFrequency1; //return the new array
 }
 
-/*finds the smallest node in the array*/
-int findMinNode(Node* tree, int excludedIndex, int size) {
-    int minIndex = -1; //initialise minIndex to -1 to indicate that no minimum has been found yet
-    int minValue = INT_MAX; //initialise minValue to INT_MAX to ensure that the first node is always smaller
+/*compares two nodes by frequency, equal frequencies are ordered by index so the tree does not depend on the heap layout*/
+int nodeIsSmaller(Node* tree, int first, int second) {
+    return tree[first].value < tree[second].value || (tree[first].value == tree[second].value && first < second);
+}
 
-    for (int i = 0; i < size; ++i) { //loop through all nodes in the tree
-        if (tree[i].value != -1 && i != excludedIndex) { //if the node is not excluded and not already used
-            if (tree[i].value < minValue) { //if the value of the node is smaller than the current minimum
-                minValue = tree[i].value; //replace the current minimum with the value of the node
-                minIndex = i; //replace the current minimum index with the index of the node
-            }
+/*adds a node index to the min-heap*/
+void pushHeap(int* heap, int* heapSize, Node* tree, int index) {
+    int position = (*heapSize)++; //start at the end of the heap
+    while (position > 0) { //move the node up while it is smaller than its parent
+        int parent = (position - 1) / 2;
+        if (!nodeIsSmaller(tree, index, heap[parent])) {
+            break;
         }
+        heap[position] = heap[parent]; //move the parent down
+        position = parent;
     }
+    heap[position] = index;
+}
 
-    return minIndex; //return the index of the smallest node
+/*removes and returns the index of the smallest node from the min-heap*/
+int popHeap(int* heap, int* heapSize, Node* tree) {
+    int smallest = heap[0]; //the root of the heap is the smallest node
+    int last = heap[--(*heapSize)]; //the last node is moved down from the root
+    int position = 0;
+    while (1) { //move the last node down while one of its children is smaller
+        int child = 2 * position + 1;
+        if (child >= *heapSize) {
+            break;
+        }
+        if (child + 1 < *heapSize && nodeIsSmaller(tree, heap[child + 1], heap[child])) { //take the smaller child
+            child++;
+        }
+        if (!nodeIsSmaller(tree, heap[child], last)) {
+            break;
+        }
+        heap[position] = heap[child]; //move the child up
+        position = child;
+    }
+    heap[position] = last;
+    return smallest;
 }
 
-/*builds the huffman tree and returns its address by reference*/
+/*builds the huffman tree in the preallocated array of 2n-1 nodes, the root is the last node*/
 Node* buildHuffmanTree(Node *tree, int *size, Frequency *characterFrequency){
     int i = 0;
-    int NodesLeft = *size; //number of leaf nodes left to build the tree
+    int heap[NUMBER_SYMBOLS]; //min-heap of the indices of the nodes that still need a parent, never holds more than all leaves
+    int heapSize = 0; //number of nodes in the heap
     int smallOne,smallTwo; //smallest two nodes in the tree
 
     for (i=0;i<*size;i++){ //initialise tree leaf nodes
@@ -187,161 +3084,672 @@ Node* buildHuffmanTree(Node *tree, int *size, Frequency *characterFrequency){
         tree[i].right = -1; //right child, will eventually contain the index of the right child node, so initialise to -1
     }
 
-    // Add EOF character to the tree
-    tree[*size].value = 1; // EOF frequency
-    tree[*size].letter = EOF; // EOF character
-    tree[*size].left = -1; //left child, will eventually contain the index of the left child node, so initialise to -1
-    tree[*size].right = -1; //right child, will eventually contain the index of the right child node, so initialise to -1
-    (*size)++; //increment size of tree
-    NodesLeft++; //increment number of leaf nodes left to build the tree
-
-    while (NodesLeft>1){ //while there are still leaf nodes left to build the tree
-        smallOne=findMinNode(tree,-1, *size); //find the smallest node in the tree, get the index of the smallest node
-        smallTwo=findMinNode(tree,smallOne, *size); //find the second smallest node in the tree, get the index of the second smallest node
+    for (i=0;i<*size;i++){ //all leaves start in the heap
+        pushHeap(heap, &heapSize, tree, i);
+    }
 
-        tree = realloc(tree, sizeof(Node) * ((*size)+1)); //reallocate memory for the tree as another node is added
+    while (heapSize>1){ //while there is more than one node without a parent
+        smallOne=popHeap(heap, &heapSize, tree); //get the index of the smallest node
+        smallTwo=popHeap(heap, &heapSize, tree); //get the index of the second smallest node
 
         tree[*size].value=tree[smallOne].value+tree[smallTwo].value; //value of the new node is the sum of the values of the two smallest nodes
         tree[*size].letter=-2; //letter of the new node is -2 to indicate that it is not a leaf node, but does not really matter
         tree[*size].left=smallTwo; //left child of the new node is the second smallest node
         tree[*size].right=smallOne; //right child of the new node is the smallest node
-        tree[smallOne].value=-1; //set the value of the smallest node to -1 to indicate that it has been used
-        tree[smallTwo].value=-1; //set the value of the second smallest node to -1 to indicate that it has been used
-        NodesLeft--; //decrement number of leaf nodes left to build the tree
+        pushHeap(heap, &heapSize, tree, *size); //the new node needs a parent too
         (*size)++; //increment size of tree
     }
 
-    return tree; //return address of final node in the tree, the root node
+    return tree; //return address of the tree, the root node is the last node
+}
+
+/*Function to build the canonical code table*/
+int buildCodeTable(Node* tree, int root, Code* codeTable, int maxCodeLength) {
+    findCodeLengths(tree, root, codeTable, 0); //only the code lengths are taken from the tree
+
+    for (int i = 0; i < NUMBER_SYMBOLS; ++i) { //skewed frequencies can make the tree deeper than the limit
+        if (codeTable[i].length > maxCodeLength) {
+            limitCodeLengths(tree, (root + 2) / 2, codeTable, maxCodeLength); //a tree with n leaves has 2n-1 nodes, the leaves come first
+            break;
+        }
+    }
+
+    return assignCanonicalCodes(codeTable); //the codes themselves are derived from the lengths, so the header only needs the lengths
 }
 
-/*Function to build the code table*/
-void buildCodeTable(Node* tree, int index, Code* codeTable, char* currentCode, int depth) {
-    //Recursively traverses the tree to build the code table
-    // If the node is a leaf, assign the binary code stored in current code to the corresponding character
-    int LeftIndex = tree[index].left; //get index of left child node, done for readability
-    if (tree[LeftIndex].left == -1 && tree[LeftIndex].right == -1) { //if the node is a leaf
-        currentCode[depth] = '0'; //add a 0 to the current code
-        codeTable[tree[LeftIndex].letter].letter = tree[LeftIndex].letter; //assign the character to the code table
-        codeTable[tree[LeftIndex].letter].code = malloc((depth+1)*sizeof(char)); //allocate memory for the code
-        memcpy(codeTable[tree[LeftIndex].letter].code, currentCode, (depth+1)*sizeof(char)); //copy the code from currentCode to the code table
-        codeTable[tree[LeftIndex].letter].length = depth+1; //assign the length of the code to the code table variable length        
+/*Function to find the best code lengths of at most maxCodeLength bits with the package-merge algorithm*/
+void limitCodeLengths(Node* tree, int numberLeaves, Code* codeTable, int maxCodeLength) {
+    //Every leaf is a coin of its frequency, at every length. Starting from the longest length, neighbouring coins are paired into packages,
+    //which are merged with the leaves of the next shorter length. The 2n-2 cheapest items of the last list give the code lengths:
+    //each leaf gets one bit for every list in which it is selected. Selected items always form the start of a list, so only counts are tracked.
+    int order[NUMBER_SYMBOLS]; //leaves sorted by frequency
+    for (int i = 0; i < numberLeaves; ++i) { //insertion sort, there are at most 256 leaves
+        int j = i;
+        while (j > 0 && tree[order[j - 1]].value > tree[i].value) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    unsigned long long weight[2][2 * NUMBER_SYMBOLS]; //weights of the previous and the current list
+    unsigned char isPackage[MAX_CODE_LENGTH][2 * NUMBER_SYMBOLS]; //type of every item of every list, 1 for a package, 0 for a leaf
+    int listLength = numberLeaves;
+    for (int i = 0; i < numberLeaves; ++i) { //the list of the longest length only holds the leaves
+        weight[0][i] = (unsigned long long)tree[order[i]].value;
+        isPackage[0][i] = 0;
     }
-    else { //if the node is not a leaf
-        currentCode[depth] = '0'; //add a 0 to the current code
-        buildCodeTable(tree, LeftIndex, codeTable, currentCode, depth + 1); //call function again for the left child node, increment depth
+
+    for (int level = 1; level < maxCodeLength; ++level) { //merge the leaves with the packages of the previous list
+        unsigned long long *previous = weight[(level - 1) & 1];
+        unsigned long long *current = weight[level & 1];
+        int numberPackages = listLength / 2; //an odd item left over is dropped
+        int leaf = 0, package = 0, length = 0;
+        while (leaf < numberLeaves || package < numberPackages) {
+            unsigned long long packageWeight = package < numberPackages ? previous[2 * package] + previous[2 * package + 1] : 0;
+            if (package == numberPackages || (leaf < numberLeaves && (unsigned long long)tree[order[leaf]].value <= packageWeight)) {
+                current[length] = (unsigned long long)tree[order[leaf++]].value;
+                isPackage[level][length++] = 0;
+            }
+            else {
+                current[length] = packageWeight;
+                isPackage[level][length++] = 1;
+                package++;
+            }
+        }
+        listLength = length;
     }
 
-    int RightIndex = tree[index].right; //get index of right child node, done for readability
-    if (tree[RightIndex].right == -1 && tree[RightIndex].left == -1) { //if the node is a leaf
-        currentCode[depth] = '1'; //add a 1 to the current code
-        codeTable[tree[RightIndex].letter].letter = tree[RightIndex].letter; //assign the character to the code table
-        codeTable[tree[RightIndex].letter].code = malloc((depth+1)*sizeof(char)); //allocate memory for the code
-        memcpy(codeTable[tree[RightIndex].letter].code, currentCode, (depth+1)*sizeof(char)); //copy the code from currentCode to the code table
-        codeTable[tree[RightIndex].letter].length = depth+1; //assign the length of the code to the code table variable length
+    for (int i = 0; i < numberLeaves; ++i) {
+        codeTable[tree[order[i]].letter].length = 0;
+    }
+    int selected = 2 * numberLeaves - 2; //number of items taken from the list of the shortest length
+    for (int level = maxCodeLength - 1; level >= 0 && selected > 0; --level) { //follow the selected packages back to the longer lengths
+        int leaf = 0, numberPackages = 0;
+        for (int i = 0; i < selected; ++i) {
+            if (isPackage[level][i]) {
+                numberPackages++;
+            }
+            else {
+                codeTable[tree[order[leaf++]].letter].length++; //the selected leaves are the cheapest ones, in order
+            }
+        }
+        selected = 2 * numberPackages; //a package is made of two items of the previous list
     }
-    else { //if the node is not a leaf
-        currentCode[depth] = '1'; //add a 1 to the current code
-        buildCodeTable(tree, RightIndex, codeTable, currentCode, depth + 1); //call function again for the right child node, increment depth
+}
+
+/*Function to find the code length of every leaf of the Huffman tree*/
+void findCodeLengths(Node* tree, int index, Code* codeTable, int depth) {
+    //Recursively traverses the tree, the depth of a leaf is the length of its code
+    if (tree[index].left == -1 && tree[index].right == -1) { //if the node is a leaf
+        codeTable[tree[index].letter].letter = tree[index].letter; //assign the character to the code table
+        codeTable[tree[index].letter].length = depth > 0 ? depth : 1; //a tree made of a single leaf still needs one bit per symbol
+        return;
     }
+
+    findCodeLengths(tree, tree[index].left, codeTable, depth + 1); //call function again for the left child node, increment depth
+    findCodeLengths(tree, tree[index].right, codeTable, depth + 1); //call function again for the right child node, increment depth
 }
 
-/*Function to write the code table and its size to the header of a binary output file*/
-void writeCodeTable2FileBinary(FILE* file, Code* codeTable, int tableSize) {
+/*Function to assign canonical codes to a code table that only contains code lengths*/
+int assignCanonicalCodes(Code* codeTable) {
+    //Canonical codes: shorter codes come first, codes of the same length are consecutive numbers in symbol order
+    int numberCodes[MAX_CODE_LENGTH + 1] = {0}; //number of codes of each length
+    for (int i = 0; i < NUMBER_SYMBOLS; ++i) {
+        numberCodes[codeTable[i].length]++;
+    }
+    numberCodes[0] = 0; //symbols that do not occur get no code
 
-    fwrite(&tableSize, sizeof(char), 1, file); //write size of code table to the file
+    unsigned long long nextCode[MAX_CODE_LENGTH + 1]; //next free code of each length
+    unsigned long long code = 0;
+    for (int length = 1; length <= MAX_CODE_LENGTH; ++length) {
+        code = (code + numberCodes[length - 1]) << 1; //first code of this length follows the last code of the previous length
+        nextCode[length] = code;
+    }
 
-    for (int i = 0; i < ASCII_SIZE; ++i) { //loop through all ASCII characters
-        if (codeTable[i].code != NULL) { //if the character exists in the code table
-            
-            fwrite(&codeTable[i].letter, sizeof(char), 1, file); //write the character to the file
-            fwrite(&codeTable[i].length, sizeof(char), 1, file); //write the length of the code to the file, limits the code length to 255 bits, cuz sizeof(char)
-            fwrite(codeTable[i].code, sizeof(char), codeTable[i].length, file); //write the code to the file
+    for (int i = 0; i < NUMBER_SYMBOLS; ++i) { //hand out the codes in symbol order
+        int length = codeTable[i].length;
+        if (length == 0) {
+            continue;
         }
+        if (nextCode[length] >= ((unsigned long long)1 << length)) { //more codes than fit into this length, the lengths are not a valid Huffman code
+            fprintf(stderr, "Invalid code lengths in code table\n");
+            return 1; //return 1 on error
+        }
+        codeTable[i].code = (unsigned int)nextCode[length]++;
     }
+
+    return 0; //return 0 on success
 }
 
-/*Function to write a binary string to a file*/
-void writeBinaryString2File(FILE* file, char index, Code* codeTable, int size) {
-    static unsigned char byte = 0; //make byte static to keep its value across function calls
-    static int bitIndex = 7; //make bitIndex static to keep its value across function calls
+/*Function to write the code lengths to the header of a compressed block*/
+int writeCodeTable2Buffer(ByteBuffer* output, Code* codeTable) {
+    //Header: number of ranges, ranges of characters that occur (first character, count - 1), then LENGTH_BITS per code length
+    unsigned char header[MAX_TABLE_SIZE]; //largest possible header: 128 ranges and every symbol present
+    int position = 0; //number of bytes written to header
+
+    int rangePosition = position++; //number of ranges is filled in once the ranges are known
+    int numberRanges = 0;
+    for (int i = 0; i < ASCII_SIZE; ++i) { //characters that occur are stored as ranges, text mostly uses a few runs of consecutive characters
+        if (codeTable[i].length == 0) {
+            continue;
+        }
+        int start = i;
+        while (i + 1 < ASCII_SIZE && codeTable[i + 1].length != 0) { //extend the range as long as the next character occurs too
+            i++;
+        }
+        header[position++] = (unsigned char)start; //first character of the range
+        header[position++] = (unsigned char)(i - start); //number of characters in the range minus 1
+        numberRanges++;
+    }
+    header[rangePosition] = (unsigned char)numberRanges;
+
+    unsigned int bitBuffer = 0; //bits waiting to be written to header
+    int bitCount = 0; //number of bits waiting in bitBuffer
+    for (int i = 0; i < NUMBER_SYMBOLS; ++i) { //code lengths in symbol order
+        if (codeTable[i].length == 0) {
+            continue;
+        }
+        bitBuffer = (bitBuffer << LENGTH_BITS) | (unsigned int)(codeTable[i].length - 1); //lengths are 1 to 15, so length - 1 fits into 4 bits
+        bitCount += LENGTH_BITS;
+        while (bitCount >= 8) { //write every complete byte
+            header[position++] = (unsigned char)(bitBuffer >> (bitCount - 8));
+            bitCount -= 8;
+        }
+    }
+    if (bitCount > 0) { //pad the last byte with zeros
+        header[position++] = (unsigned char)(bitBuffer << (8 - bitCount));
+    }
+
+    return appendByteBuffer(output, header, position); //write the whole header at once
+}
 
-    const char* binaryString = codeTable[index].code; //get the binary string from the code table
-    int length = codeTable[index].length; //get the length of the binary string
+/*Function to initialise a bit writer that appends to a byte buffer*/
+void initBitWriter(BitWriter* writer, ByteBuffer* output) {
+    writer->bits = 0;
+    writer->bitCount = 0;
+    writer->output = output;
+}
 
-    for (int i = 0; i < length; ++i) { //loop through all bits in the binary string
-        if (binaryString[i] == '1') { //if the bit is 1
-            byte |= (1 << bitIndex); //set the bit at bitIndex to 1
-        }         
-        bitIndex--; //decrement bitIndex
+/*Function to append a code to a bit writer*/
+int writeBits(BitWriter* writer, unsigned int code, int length) {
+    writer->bits = (writer->bits << length) | code; //below 32 pending bits plus a code of at most 32 bits always fit the register
+    writer->bitCount += length;
 
-        if (bitIndex < 0) { //if all bits are set
-            fwrite(&byte, sizeof(unsigned char), 1, file); //write the byte to the file
-            byte = 0; //reset byte to 0
-            bitIndex = 7; //reset bitIndex to 7
+    if (writer->bitCount >= 32) { //move a whole 32 bit word to the output buffer
+        ByteBuffer* output = writer->output;
+        if (output->length + 4 > output->capacity && reserveByteBuffer(output, 4) != 0) { //the buffer is full, grow it
+            return 1; //return 1 on error
         }
+        unsigned int word = (unsigned int)(writer->bits >> (writer->bitCount - 32)); //the 32 oldest pending bits
+        output->data[output->length] = (unsigned char)(word >> 24); //highest byte first, the stream is read from the highest bit
+        output->data[output->length + 1] = (unsigned char)(word >> 16);
+        output->data[output->length + 2] = (unsigned char)(word >> 8);
+        output->data[output->length + 3] = (unsigned char)word;
+        output->length += 4;
+        writer->bitCount -= 32;
     }
+    return 0; //return 0 on success
+}
 
-    if (index == size - 1 && bitIndex != 7) { //if this is the last character and not all bits are set
-        fwrite(&byte, sizeof(unsigned char), 1, file); //write the byte to the file
+/*Function to pad the last byte with zeros and move everything left in a bit writer to its buffer*/
+int flushBitWriter(BitWriter* writer) {
+    ByteBuffer* output = writer->output;
+    if (reserveByteBuffer(output, 4) != 0) { //make room for the last pending bits
+        return 1; //return 1 on error
+    }
+    while (writer->bitCount > 0) { //move the pending bits byte by byte, the last byte is padded with zeros
+        int shift = writer->bitCount - 8;
+        output->data[output->length++] = (unsigned char)(shift >= 0 ? writer->bits >> shift : writer->bits << -shift);
+        writer->bitCount -= 8;
     }
+    writer->bitCount = 0;
+    writer->bits = 0;
+    return 0; //return 0 on success
 }
 
 /*Functions required for decompression---------------------------------------------------------------------------------------*/
-/*Function to reconstruct code table from binary file*/
-Code* reconstructCodeTableFromFileBinary(FILE* file, int* tableSize) {
+/*Function to reconstruct the code table from the header of a compressed block*/
+Code* reconstructCodeTableFromBuffer(const unsigned char* data, size_t length, size_t* position, int* tableSize, Arena* arena) {
 
-    if (fread(tableSize, sizeof(char), 1, file) < 1) { //read the size of the code table
-        fprintf(stderr, "Error reading code table size from file\n"); //print error message if reading fails
+    if (length - *position < 1) { //read the number of ranges
+        fprintf(stderr, "Error reading code table from block\n"); //print error message if reading fails
         return NULL;  //return NULL on error
     }
+    int numberRanges = data[(*position)++];
+    if (numberRanges > 128 || length - *position < (size_t)(2 * numberRanges)) { //check that the ranges are complete
+        fprintf(stderr, "Error reading code table from block\n");
+        return NULL;
+    }
+    const unsigned char* ranges = data + *position; //first character and count - 1 of every range
+    *position += 2 * numberRanges;
 
-    Code* codeTable = malloc((*tableSize) * sizeof(Code)); //allocate memory for the code table
-
-    for (int i = 0; i < (*tableSize); ++i) { //loop through all entries in the code table
-        fread(&codeTable[i].letter, sizeof(char), 1, file); //read the character
+    Code* codeTable = arenaAlloc(arena, NUMBER_SYMBOLS * sizeof(Code)); //code table, one entry per symbol
+    if (codeTable == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < NUMBER_SYMBOLS; ++i) { //initialise code table
+        codeTable[i].letter = i;
+        codeTable[i].code = 0;
+        codeTable[i].length = 0;
+    }
 
-        int length;
-        fread(&length, sizeof(char), 1, file); //read the length of the code
+    *tableSize = 0;
+    for (int r = 0; r < numberRanges; ++r) { //mark the characters of every range as present
+        for (int i = ranges[2 * r]; i <= ranges[2 * r] + ranges[2 * r + 1] && i < ASCII_SIZE; ++i) {
+            if (codeTable[i].length == 0) { //overlapping ranges only count once
+                codeTable[i].length = 1; //placeholder, the real length follows
+                (*tableSize)++;
+            }
+        }
+    }
+    if (*tableSize == 0) { //a coded block has at least one character
+        fprintf(stderr, "Error reading code table from block\n");
+        return NULL;
+    }
 
-        codeTable[i].code = malloc(length + 1); //allocate memory for the code
-        fread(codeTable[i].code, sizeof(char), length, file); //read the code
-        codeTable[i].code[length] = '\0';  // Null-terminate the string
+    size_t numberLengthBytes = (*tableSize * LENGTH_BITS + 7) / 8;
+    if (length - *position < numberLengthBytes) { //check that the code lengths are complete
+        fprintf(stderr, "Error reading code table from block\n");
+        return NULL;
+    }
+    const unsigned char* lengths = data + *position; //packed code lengths
+    *position += numberLengthBytes;
+    int bitPosition = 0; //position of the next length in the packed bits
+    for (int i = 0; i < NUMBER_SYMBOLS; ++i) { //unpack the lengths in symbol order
+        if (codeTable[i].length == 0) {
+            continue;
+        }
+        int codeLength = 0;
+        for (int k = 0; k < LENGTH_BITS; ++k, ++bitPosition) { //read the length bit by bit, highest bit first
+            codeLength = (codeLength << 1) | ((lengths[bitPosition / 8] >> (7 - bitPosition % 8)) & 1);
+        }
+        codeTable[i].length = codeLength + 1; //length - 1 is stored
+        if (codeTable[i].length > MAX_CODE_LENGTH) { //LENGTH_BITS can hold one length more than allowed
+            fprintf(stderr, "Error reading code table from block\n");
+            return NULL;
+        }
+    }
 
-        codeTable[i].length = length; //assign the length of the code to the code table variable length
+    if (assignCanonicalCodes(codeTable) != 0) { //the codes follow from the lengths
+        return NULL;
     }
 
     return codeTable; //return the full reconstructed code table
 }
 
-/*Function to decode a binary file using Huffman coding table*/
-void decodeBinaryFile(FILE *input, FILE *output, Code *codeTable, int tableSize) {
+/*Function to build the lookup table used to decode a whole code at once*/
+int buildDecodeTable(Code *codeTable, DecodeTable *decodeTable, Arena *arena) {
+    //Codes are at most MAX_CODE_LENGTH bits, so one table indexed by the longest code resolves every code with a single lookup
+    decodeTable->bits = 0; //length of the longest code
+    for (int i = 0; i < NUMBER_SYMBOLS; ++i) {
+        if (codeTable[i].length > decodeTable->bits) {
+            decodeTable->bits = codeTable[i].length;
+        }
+    }
 
-    int buffer = 0; //buffer to store bits
-    int bufferLength = 0; //number of bits in the buffer
+    decodeTable->entries = arenaAlloc(arena, ((size_t)1 << decodeTable->bits) * sizeof(DecodeEntry));
+    if (decodeTable->entries == NULL) {
+        return 1; //return 1 on error
+    }
+    memset(decodeTable->entries, 0, ((size_t)1 << decodeTable->bits) * sizeof(DecodeEntry)); //length 0 marks slots no code starts with, only possible in corrupted blocks
 
-    while (1) {
-        unsigned char byte;
-        if (fread(&byte, 1, 1, input) == 0) { //read one byte from the file, store in byte
-            break; //and if its return value is 0, reached EOF, so break out of the loop
+    for (int i = 0; i < NUMBER_SYMBOLS; ++i) { //fill every slot that starts with the code of a symbol
+        int length = codeTable[i].length;
+        if (length == 0) {
+            continue;
+        }
+        int shift = decodeTable->bits - length; //number of bits following the code in a slot index
+        unsigned int first = codeTable[i].code << shift; //first slot starting with the code
+        for (unsigned int slot = first; slot < first + (1u << shift); ++slot) {
+            decodeTable->entries[slot].letter = (unsigned char)i;
+            decodeTable->entries[slot].length = (unsigned char)length;
+        }
+    }
+
+    return 0; //return 0 on success
+}
+
+/*Function to build the pair table of interleaved blocks from a decode table of at most PAIR_TABLE_BITS bits*/
+void buildPairTable(const DecodeTable *decodeTable, DecodePair *pairs) {
+    //A slot holds the code its bits start with, and the code after it if that one also fits into the bits of the slot.
+    //With the codes of text, most slots hold two codes, so a stream needs half as many lookups.
+    int bits = decodeTable->bits;
+    size_t mask = ((size_t)1 << bits) - 1;
+    for (size_t slot = 0; slot <= mask; slot++) {
+        DecodeEntry first = decodeTable->entries[slot];
+        pairs[slot].letters[0] = first.letter;
+        pairs[slot].letters[1] = 0;
+        pairs[slot].length = first.length;
+        pairs[slot].count = 1;
+        if (first.length > 0 && first.length < bits) {
+            DecodeEntry second = decodeTable->entries[(slot << first.length) & mask]; //the bits after the first code, padded with zeros
+            if (second.length > 0 && second.length <= bits - first.length) { //the padding is not part of the second code
+                pairs[slot].letters[1] = second.letter;
+                pairs[slot].length = (unsigned char)(first.length + second.length);
+                pairs[slot].count = 2;
+            }
+        }
+    }
+}
+
+/*Function to load 8 bytes of a bit stream, the first byte becomes the highest byte, inline because it is called in the innermost decoding loop*/
+static inline uint64_t loadBits64(const unsigned char *data) {
+    return ((uint64_t)data[0] << 56) | ((uint64_t)data[1] << 48) | ((uint64_t)data[2] << 40) | ((uint64_t)data[3] << 32)
+         | ((uint64_t)data[4] << 24) | ((uint64_t)data[5] << 16) | ((uint64_t)data[6] << 8) | (uint64_t)data[7]; //compilers turn this into one load and a byte swap
+}
+
+/*Function to get the next 57 or more bits of a bit stream starting at bitPosition, bits after the end of the stream are zeros*/
+uint64_t peekBits(const unsigned char *data, size_t length, size_t bitPosition) {
+    size_t byte = bitPosition >> 3;
+    uint64_t bits = 0;
+    if (byte + 8 <= length) {
+        bits = loadBits64(data + byte);
+    }
+    else {
+        for (int k = 0; k < 8 && byte + k < length; k++) { //end of the stream, load byte by byte
+            bits |= (uint64_t)data[byte + k] << (56 - 8 * k);
         }
+    }
+    return bits << (bitPosition & 7);
+}
+
+/*Function to decode the bit stream of a block using the decode table, returns 0 if it decodes to exactly rawLength characters*/
+int decodeBinaryBlock(const unsigned char *data, size_t length, unsigned char *output, size_t rawLength, const DecodeTable *decodeTable) {
+    //The frame holds the number of characters, so the loop only counts them and does not compare every symbol with an end marker
+    int bits = decodeTable->bits;
+    if (bits < 1 || bits > MAX_CODE_LENGTH) {
+        return 1; //return 1 on error
+    }
+    const DecodeEntry *entries = decodeTable->entries;
+    size_t bitPosition = 0; //number of bits decoded
+    size_t outLength = 0; //number of decoded characters
+    int codesPerLoad = 57 / bits; //codes that surely fit into the 57 bits of one load
 
-        for (int i = 7; i >= 0; i--) { //loop through all bits in the byte
-            buffer = (buffer << 1) | ((byte >> i) & 1); //add the current bit to the buffer
-            bufferLength++; //increment the number of bits in the buffer
+    while (outLength + codesPerLoad <= rawLength && (bitPosition >> 3) + 8 <= length) { //fast loop: 8 bytes left to load and codesPerLoad characters left to decode
+        uint64_t buffer = loadBits64(data + (bitPosition >> 3)) << (bitPosition & 7); //bit buffer, the next bit of the stream is always the highest bit
+        for (int k = 0; k < codesPerLoad; k++) {
+            DecodeEntry entry = entries[buffer >> (64 - bits)]; //look up the whole next code at once
+            output[outLength + k] = entry.letter;
+            buffer <<= entry.length; //remove the decoded code from the buffer
+            bitPosition += entry.length;
+        }
+        outLength += codesPerLoad;
+    }
+    while (outLength < rawLength) { //end of the stream, one code at a time with bounds checks
+        if (bitPosition >= 8 * length) { //the stream ended before all characters, the block is truncated
+            return 1;
+        }
+        DecodeEntry entry = entries[peekBits(data, length, bitPosition) >> (64 - bits)];
+        output[outLength++] = entry.letter;
+        bitPosition += entry.length;
+    }
+    if (bitPosition > 8 * length || 8 * length - bitPosition >= 8) { //the stream has to end in its last byte, which catches most corrupted blocks
+        return 1;
+    }
+    return 0; //return 0 on success
+}
 
-            //check for a match in the Huffman coding table
-            for (int j = 0; j < tableSize; j++) { //loop through all entries in the code table
-                if (bufferLength == codeTable[j].length && buffer == strtol(codeTable[j].code, NULL, 2)) { //if the buffer matches the code in the code table, and the length of the buffer matches the length of the code
-                    fprintf(output, "%c", codeTable[j].letter); //write the character to the output file
-                    //printf("%c", codeTable[j].letter); //print the character to the terminal
+/*Function to decode a block of INTERLEAVED_STREAMS bit streams, returns 0 if the streams decode to exactly rawLength characters*/
+int decodeInterleaved(const unsigned char *data, size_t length, unsigned char *output, size_t rawLength, const DecodeTable *decodeTable) {
+    //The streams are independent, so the loop decodes one character of every stream in turn and the processor overlaps the four chains of
+    //table lookups. One 64 bit load gives at least 57 bits, which hold 57 / bits codes: 5 at the default limit of 11 bits, 3 at MAX_CODE_LENGTH.
+    //Each lookup waits for the one before it in its stream, so long blocks look up the pair table, which decodes two short codes at once.
+    if (length < JUMP_TABLE_SIZE || decodeTable->bits < 1 || decodeTable->bits > MAX_CODE_LENGTH) {
+        return 1; //return 1 on error
+    }
+    const unsigned char *start[INTERLEAVED_STREAMS]; //first byte of every stream
+    size_t size[INTERLEAVED_STREAMS]; //number of bytes of every stream
+    size_t bitPosition[INTERLEAVED_STREAMS] = {0}; //number of bits decoded from every stream
+    unsigned char *out[INTERLEAVED_STREAMS]; //next character of every stream
+    unsigned char *outEnd[INTERLEAVED_STREAMS]; //end of the characters of every stream
+    size_t position = JUMP_TABLE_SIZE;
+    size_t part = (rawLength + INTERLEAVED_STREAMS - 1) / INTERLEAVED_STREAMS;
+    for (int s = 0; s < INTERLEAVED_STREAMS; s++) {
+        size[s] = s < INTERLEAVED_STREAMS - 1 ? getU32(data + 4 * s) : length - position;
+        if (size[s] > length - position) { //the stream does not fit the block
+            return 1;
+        }
+        start[s] = data + position;
+        position += size[s];
+        size_t first = s * part < rawLength ? s * part : rawLength;
+        out[s] = output + first;
+        outEnd[s] = output + (first + part < rawLength ? first + part : rawLength);
+    }
 
-                    bufferLength -= codeTable[j].length; //decrement the number of bits in the buffer by the length of the code
-                    buffer &= ~(0xFFFFFFFF << bufferLength); //reset the buffer to the remaining bits
-                    break; //break out of the loop
+    int bits = decodeTable->bits;
+    const DecodeEntry *entries = decodeTable->entries;
+    DecodePair pairs[1 << PAIR_TABLE_BITS]; //up to two codes per lookup, which halves the lookups of text
+    int usePairs = bits <= PAIR_TABLE_BITS && rawLength >= ((size_t)PAIR_MIN_SYMBOLS << bits);
+    if (usePairs) {
+        buildPairTable(decodeTable, pairs);
+    }
+    //The fast loop keeps the state of the streams in locals, stores through unsigned char pointers could change the arrays otherwise
+    size_t position0 = 0, position1 = 0, position2 = 0, position3 = 0; //number of bits decoded from every stream
+    unsigned char *out0 = out[0], *out1 = out[1], *out2 = out[2], *out3 = out[3];
+    int codesPerLoad = 57 / bits; //codes of every stream that surely fit into the 57 loaded bits, 5 with the default limit of 11 bits
+    size_t roundBits = usePairs ? (size_t)PAIR_LOOKUPS * bits : (size_t)codesPerLoad * bits; //most bits a round takes from a stream, a pair slot takes at most bits too
+    size_t roundSymbols = usePairs ? 2 * (size_t)PAIR_LOOKUPS : (size_t)codesPerLoad; //most characters a round writes to a stream
+    while (1) { //batches of rounds without checks, for as many rounds as every stream surely has 8 bytes to load and room for its characters
+        size_t rounds = ~(size_t)0;
+        size_t positions[INTERLEAVED_STREAMS] = {position0, position1, position2, position3};
+        unsigned char *outs[INTERLEAVED_STREAMS] = {out0, out1, out2, out3};
+        for (int s = 0; s < INTERLEAVED_STREAMS; s++) {
+            size_t loads = 8 * size[s] < positions[s] + 64 ? 0 : (8 * size[s] - 64 - positions[s]) / roundBits + 1;
+            size_t room = (size_t)(outEnd[s] - outs[s]) / roundSymbols;
+            rounds = loads < rounds ? loads : rounds;
+            rounds = room < rounds ? room : rounds;
+        }
+        if (rounds == 0) { //the last rounds of the streams are left to the loop with checks below
+            break;
+        }
+        if (usePairs) { //the mode is tested once per batch, so the compiler keeps both round loops tight
+            for (size_t round = 0; round < rounds; round++) {
+                uint64_t buffer0 = loadBits64(start[0] + (position0 >> 3)) << (position0 & 7);
+                uint64_t buffer1 = loadBits64(start[1] + (position1 >> 3)) << (position1 & 7);
+                uint64_t buffer2 = loadBits64(start[2] + (position2 >> 3)) << (position2 & 7);
+                uint64_t buffer3 = loadBits64(start[3] + (position3 >> 3)) << (position3 & 7);
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 8) //the pragma is not known to older compilers
+#pragma GCC unroll 5 //PAIR_LOOKUPS, -O2 does not unroll the lookups by itself
+#endif
+                for (int k = 0; k < PAIR_LOOKUPS; k++) {
+                    DecodePair pair0 = pairs[buffer0 >> (64 - bits)];
+                    DecodePair pair1 = pairs[buffer1 >> (64 - bits)];
+                    DecodePair pair2 = pairs[buffer2 >> (64 - bits)];
+                    DecodePair pair3 = pairs[buffer3 >> (64 - bits)];
+                    memcpy(out0, pair0.letters, 2); //both letters are written, the room of the round covers the second one
+                    memcpy(out1, pair1.letters, 2);
+                    memcpy(out2, pair2.letters, 2);
+                    memcpy(out3, pair3.letters, 2);
+                    out0 += pair0.count;
+                    out1 += pair1.count;
+                    out2 += pair2.count;
+                    out3 += pair3.count;
+                    buffer0 <<= pair0.length;
+                    buffer1 <<= pair1.length;
+                    buffer2 <<= pair2.length;
+                    buffer3 <<= pair3.length;
+                    position0 += pair0.length;
+                    position1 += pair1.length;
+                    position2 += pair2.length;
+                    position3 += pair3.length;
                 }
             }
         }
+        else {
+            for (size_t round = 0; round < rounds; round++) {
+                uint64_t buffer0 = loadBits64(start[0] + (position0 >> 3)) << (position0 & 7);
+                uint64_t buffer1 = loadBits64(start[1] + (position1 >> 3)) << (position1 & 7);
+                uint64_t buffer2 = loadBits64(start[2] + (position2 >> 3)) << (position2 & 7);
+                uint64_t buffer3 = loadBits64(start[3] + (position3 >> 3)) << (position3 & 7);
+                for (int k = 0; k < codesPerLoad; k++) {
+                    DecodeEntry entry0 = entries[buffer0 >> (64 - bits)];
+                    DecodeEntry entry1 = entries[buffer1 >> (64 - bits)];
+                    DecodeEntry entry2 = entries[buffer2 >> (64 - bits)];
+                    DecodeEntry entry3 = entries[buffer3 >> (64 - bits)];
+                    out0[k] = entry0.letter;
+                    out1[k] = entry1.letter;
+                    out2[k] = entry2.letter;
+                    out3[k] = entry3.letter;
+                    buffer0 <<= entry0.length;
+                    buffer1 <<= entry1.length;
+                    buffer2 <<= entry2.length;
+                    buffer3 <<= entry3.length;
+                    position0 += entry0.length;
+                    position1 += entry1.length;
+                    position2 += entry2.length;
+                    position3 += entry3.length;
+                }
+                out0 += codesPerLoad;
+                out1 += codesPerLoad;
+                out2 += codesPerLoad;
+                out3 += codesPerLoad;
+            }
+        }
+    }
+    out[0] = out0; out[1] = out1; out[2] = out2; out[3] = out3;
+    bitPosition[0] = position0; bitPosition[1] = position1; bitPosition[2] = position2; bitPosition[3] = position3;
+    for (int s = 0; s < INTERLEAVED_STREAMS; s++) { //end of every stream, one code at a time with bounds checks
+        while (out[s] < outEnd[s]) {
+            if (bitPosition[s] >= 8 * size[s]) { //the stream ended before all its characters
+                return 1;
+            }
+            DecodeEntry entry = entries[peekBits(start[s], size[s], bitPosition[s]) >> (64 - bits)];
+            *out[s]++ = entry.letter;
+            bitPosition[s] += entry.length;
+        }
+        if (bitPosition[s] > 8 * size[s] || 8 * size[s] - bitPosition[s] >= 8) { //every stream has to end in its last byte, which catches most corrupted blocks
+            return 1;
+        }
+    }
+    return 0; //return 0 on success
+}
+
+/*Threading functions--------------------------------------------------------------------------------------------------------*/
+/*get the number of processor cores*/
+int numberOfCores(void) {
+#ifdef _WIN32
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    int cores = (int)systemInfo.dwNumberOfProcessors;
+#else
+    int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (cores < 1) {
+        cores = 1;
+    }
+    return cores < MAX_THREADS ? cores : MAX_THREADS;
+}
+
+#ifdef _WIN32
+//Windows threads take a different function signature, so the function and its argument are passed through this struct
+typedef struct threadStart{
+    void *(*function)(void *);
+    void *argument;
+} ThreadStart;
+
+DWORD WINAPI threadTrampoline(LPVOID parameter) {
+    ThreadStart start = *(ThreadStart *)parameter;
+    free(parameter);
+    start.function(start.argument);
+    return 0;
+}
+#endif
+
+/*start a thread running function(argument), returns 0 on success*/
+int startThread(Thread *thread, void *(*function)(void *), void *argument) {
+#ifdef _WIN32
+    ThreadStart *start = malloc(sizeof(ThreadStart));
+    if (start == NULL) {
+        return 1;
     }
+    start->function = function;
+    start->argument = argument;
+    *thread = CreateThread(NULL, 0, threadTrampoline, start, 0, NULL);
+    if (*thread == NULL) {
+        free(start);
+        return 1;
+    }
+    return 0;
+#else
+    return pthread_create(thread, NULL, function, argument) != 0;
+#endif
+}
+
+/*wait for a thread to finish*/
+void joinThread(Thread thread) {
+#ifdef _WIN32
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+void initMutex(Mutex *mutex) {
+#ifdef _WIN32
+    InitializeCriticalSection(mutex);
+#else
+    pthread_mutex_init(mutex, NULL);
+#endif
+}
+
+void destroyMutex(Mutex *mutex) {
+#ifdef _WIN32
+    DeleteCriticalSection(mutex);
+#else
+    pthread_mutex_destroy(mutex);
+#endif
+}
+
+void lockMutex(Mutex *mutex) {
+#ifdef _WIN32
+    EnterCriticalSection(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+void unlockMutex(Mutex *mutex) {
+#ifdef _WIN32
+    LeaveCriticalSection(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+void initCondition(Condition *condition) {
+#ifdef _WIN32
+    InitializeConditionVariable(condition);
+#else
+    pthread_cond_init(condition, NULL);
+#endif
+}
+
+void destroyCondition(Condition *condition) {
+#ifdef _WIN32
+    (void)condition; //Windows condition variables need no cleanup
+#else
+    pthread_cond_destroy(condition);
+#endif
+}
+
+/*release the mutex, wait for a broadcast and take the mutex again*/
+void waitCondition(Condition *condition, Mutex *mutex) {
+#ifdef _WIN32
+    SleepConditionVariableCS(condition, mutex, INFINITE);
+#else
+    pthread_cond_wait(condition, mutex);
+#endif
+}
+
+/*wake every thread waiting on the condition*/
+void broadcastCondition(Condition *condition) {
+#ifdef _WIN32
+    WakeAllConditionVariable(condition);
+#else
+    pthread_cond_broadcast(condition);
+#endif
 }
 
 /*Other functions------------------------------------------------------------------------------------------------------------*/
@@ -359,22 +3767,130 @@ int getFileType(char* filename) { //check if file is .txt or .bin, returns 1 for
 }
 
 /*Summarize compression statistics*/
-void summarizeCompression(FILE *input, FILE *output) {
+void summarizeCompression(size_t inputLength, unsigned long long outputLength) {
+
+    long long originalBits = 8 * (long long)inputLength; //input size is known from loading it, pipes cannot be measured with ftell
+    long long compressedBits = 8 * (long long)outputLength; //output size is counted while writing, the output may be a pipe too
 
-    rewind(input); //reset file pointer to beginning of file to be sure
-    fseek(input, 0L, SEEK_END); //go to end of file
-    int originalBits = 8* ftell(input); //calculate input file size
+    fprintf(stderr,"Original bits = %lld",originalBits); //print original bits to terminal
+    fprintf(stderr, "\n");
+    fprintf(stderr,"Compressed bits = %lld",compressedBits); //print compressed bits to terminal
+    fprintf(stderr, "\n");
+    fprintf(stderr,"Compression ratio of %.2f%%",((double)compressedBits/(double)originalBits)*100); //print compression ratio to terminal, double keeps files of many GB exact
+    fprintf(stderr, "\n");
+    fprintf(stderr,"Saved %.2f%% of memory",(((double)originalBits-(double)compressedBits)/(double)originalBits)*100); //print saved memory to terminal
+    fprintf(stderr, "\n");
+}
 
-    rewind(output); //reset file pointer to beginning of file to be sure
-    fseek(output, 0L, SEEK_END); //go to end of file
-    int compressedBits = 8* ftell(output); //calculate output file size
+/*initialise an arena, its memory is allocated with the first allocation*/
+void initArena(Arena *arena, size_t capacity) {
+    arena->data = NULL;
+    arena->used = 0;
+    arena->capacity = capacity;
+}
 
-    fprintf(stderr,"Original bits = %d",originalBits); //print original bits to terminal
-    printf("\n");
-    fprintf(stderr,"Compressed bits = %d",compressedBits); //print compressed bits to terminal
-    printf("\n");
-    fprintf(stderr,"Compression ratio of %.2f%%",(((float)((float)compressedBits)/(float)(originalBits))*100)); //print compression ratio to terminal
-    printf("\n");
-    fprintf(stderr,"Saved %.2f%% of memory",(((float)(originalBits)-(float)compressedBits)/(float)(originalBits))*100); //print saved memory to terminal
-    printf("\n");
-}
\ No newline at end of file
+/*take memory from an arena, it is only given back all at once by resetArena*/
+void *arenaAlloc(Arena *arena, size_t size) {
+    if (arena->data == NULL) { //first allocation
+        arena->data = malloc(arena->capacity);
+        if (arena->data == NULL) {
+            fprintf(stderr, "Error allocating memory for an arena\n");
+            return NULL; //return NULL on error
+        }
+    }
+    size_t start = (arena->used + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    if (size > arena->capacity - start || start > arena->capacity) { //the arena is sized for the largest block, so this is a bug
+        fprintf(stderr, "Arena of %zu bytes is too small\n", arena->capacity);
+        return NULL;
+    }
+    arena->used = start + size;
+    return arena->data + start;
+}
+
+/*give back all memory taken from an arena, the memory itself is kept for the next block*/
+void resetArena(Arena *arena) {
+    arena->used = 0;
+}
+
+/*free the memory of an arena*/
+void freeArena(Arena *arena) {
+    free(arena->data);
+    arena->data = NULL;
+    arena->used = 0;
+}
+
+/*initialise an empty byte buffer*/
+void initByteBuffer(ByteBuffer *buffer) {
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+}
+
+/*make sure extra more bytes fit into a byte buffer, grows it at least by half so appending stays cheap*/
+int reserveByteBuffer(ByteBuffer *buffer, size_t extra) {
+    if (buffer->length + extra <= buffer->capacity) {
+        return 0; //return 0 on success
+    }
+    size_t capacity = buffer->capacity + buffer->capacity / 2;
+    if (capacity < buffer->length + extra) {
+        capacity = buffer->length + extra;
+    }
+    if (capacity < IO_BUFFER_SIZE) {
+        capacity = IO_BUFFER_SIZE;
+    }
+    unsigned char *bigger = realloc(buffer->data, capacity);
+    if (bigger == NULL) {
+        fprintf(stderr, "Error allocating memory for a buffer\n");
+        return 1; //return 1 on error
+    }
+    buffer->data = bigger;
+    buffer->capacity = capacity;
+    return 0;
+}
+
+/*append bytes to a byte buffer*/
+int appendByteBuffer(ByteBuffer *buffer, const void *data, size_t length) {
+    if (reserveByteBuffer(buffer, length) != 0) {
+        return 1; //return 1 on error
+    }
+    if (length > 0) { //empty appends may pass a NULL buffer
+        memcpy(buffer->data + buffer->length, data, length);
+    }
+    buffer->length += length;
+    return 0; //return 0 on success
+}
+
+/*free the memory of a byte buffer*/
+void freeByteBuffer(ByteBuffer *buffer) {
+    free(buffer->data);
+    initByteBuffer(buffer);
+}
+
+/*store and load little-endian integers, the file format does not depend on the byte order of the machine*/
+void putU32(unsigned char *destination, unsigned int value) {
+    for (int i = 0; i < 4; i++) {
+        destination[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+unsigned int getU32(const unsigned char *source) {
+    unsigned int value = 0;
+    for (int i = 3; i >= 0; i--) {
+        value = (value << 8) | source[i];
+    }
+    return value;
+}
+
+void putU64(unsigned char *destination, unsigned long long value) {
+    for (int i = 0; i < 8; i++) {
+        destination[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+unsigned long long getU64(const unsigned char *source) {
+    unsigned long long value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | source[i];
+    }
+    return value;
+}
@@ -1,25 +1,254 @@
 #ifndef TYPES_H // prevents the inclusion of  header file more than once
 #define TYPES_H
 
+#include <stdio.h> // Has to be included to use FILE and size_t
+#ifdef _WIN32 // Threads, mutexes and condition variables of the block thread pool
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/*Definition of constants-----------------------------------------------------------------------*/
+#define NUMBER_SYMBOLS 256 // Every byte value is a symbol, the number of symbols of a block is stored in its frame instead of an end marker
+#define MAX_CODE_LENGTH 15 // Longest code the encoder produces and the decoder accepts, codes are length-limited so a decode table covers every code
+#define NUMBER_BLOCK_MODES 5 // Number of block modes, see the BLOCK_ constants in huffman_code.c
+#define NUMBER_PHASES 11 // Number of timed phases of the statistics, see the PHASE_ constants in huffman_code.c
+
 /*Definition of structs-------------------------------------------------------------------------*/
 // Node of the huffman tree
 typedef struct node{
     int value; // Frequency of the character
-    char letter; // Character
+    int letter; // Symbol of a leaf, a byte value
     int left, right; // Index of the left and right child
 } Node;
 
 // Frequency of each character
 typedef struct frequency{
-    char character; // Character
+    unsigned char character; // Character, unsigned so every byte value is a valid index
     int frequency; // Frequency of the character
 } Frequency;
 
 // Code structure to store the binary codes
 typedef struct code{
-    char letter; // Character
-    char* code; // Binary code (as a string)
-    int length; // Length of the binary code
+    unsigned char letter; // Symbol, a byte value
+    unsigned int code; // Canonical binary code, packed into the lowest length bits
+    int length; // Length of the binary code, 0 if the symbol does not occur
 } Code;
 
+// Whole input of the compressor, memory-mapped for regular files or read into one buffer for pipes
+typedef struct inputData{
+    unsigned char* data; // Content of the input
+    size_t length; // Number of bytes in data
+    int mapped; // 1 if data is a memory mapping, 0 if it was read into a malloc'd buffer
+} InputData;
+
+// Growable buffer of bytes, used for compressed and decompressed blocks
+typedef struct byteBuffer{
+    unsigned char* data; // Content of the buffer
+    size_t length; // Number of bytes in use
+    size_t capacity; // Number of bytes allocated
+} ByteBuffer;
+
+// Arena handing out the tables of one block from a single allocation, reset for the next block instead of freeing every table
+typedef struct arena{
+    unsigned char* data; // Memory of the arena, allocated with the first allocation
+    size_t used; // Number of bytes handed out since the last reset
+    size_t capacity; // Number of bytes in data
+} Arena;
+
+// Bit writer collecting codes in a 64 bit register and whole words in an output buffer, one per encoder so encoders do not share state
+typedef struct bitWriter{
+    unsigned long long bits; // Register of pending bits, the oldest bit is the highest of the lowest bitCount bits
+    int bitCount; // Number of pending bits in the register, always below 32 between calls
+    ByteBuffer* output; // Buffer receiving whole bytes, grown when full
+} BitWriter;
+
+// One slot of the decoding lookup table, indexed by the next bits of the stream
+typedef struct decodeEntry{
+    unsigned char letter; // Symbol decoded by this slot, entries take 2 bytes so the table stays small
+    unsigned char length; // Length of the code, 0 if no code starts with these bits
+} DecodeEntry;
+
+// One slot of the pair table of interleaved blocks, which decodes up to two short codes with a single lookup
+typedef struct decodePair{
+    unsigned char letters[2]; // Symbols decoded by this slot, the second one is only valid if count is 2
+    unsigned char length; // Length of both codes together, 0 if no code starts with these bits
+    unsigned char count; // Number of symbols decoded, 1 or 2, the slot is written as 2 bytes either way
+} DecodePair;
+
+// Lookup table used to decode a whole code at once
+typedef struct decodeTable{
+    DecodeEntry* entries; // 2^bits entries, one for every possible bit pattern
+    int bits; // Length of the longest code, so one lookup resolves every code
+} DecodeTable;
+
+// Code table trained in advance on sample files, blocks coded with it do not store a code table
+typedef struct dictionary{
+    unsigned int id; // Hash of the code lengths, stored in compressed files to find the right dictionary
+    Code codeTable[NUMBER_SYMBOLS]; // Canonical code of every symbol, every symbol has a code
+    DecodeTable decodeTable; // Lookup table built once when the dictionary is loaded, shared by all decoders
+    Arena arena; // Memory of the decode table
+} Dictionary;
+
+// Layout of the blocks of one file, stored in the flags of the container header
+typedef struct blockFormat{
+    const Dictionary* dictionary; // Dictionary the blocks may be coded with, NULL for none; with one the frames are compact
+    int numberStreams; // Number of bit streams per block, 1 or INTERLEAVED_STREAMS
+} BlockFormat;
+
+// Code table of the last block that stored one, later blocks with similar content reuse it instead of storing their own
+typedef struct tableReference{
+    Code codeTable[NUMBER_SYMBOLS]; // Codes of the table, length 0 for symbols without a code
+    long long owner; // Index of the block that stored the table, -1 if no block did yet
+} TableReference;
+
+// Analysis of one block to compress: its frequencies, the codes it is coded with and the chosen block mode
+typedef struct blockPlan{
+    Frequency* frequency; // Frequency of every character of the block
+    int numberCharacters; // Number of different characters in the block
+    const Code* codeTable; // Codes the block is coded with, its own table, the dictionary or the reused table
+    Code* ownTable; // Table built for the block alone, NULL for a block of one character
+    int mode; // Block mode, see the BLOCK_ constants in huffman_code.c
+    long long owner; // Index of the block whose table is reused, only for BLOCK_REPEAT
+} BlockPlan;
+
+// Time and amount of data of one phase of (de-)compression
+typedef struct phaseStats{
+    double seconds; // Time spent in the phase, summed over all blocks and worker threads
+    unsigned long long bytes; // Number of bytes the phase read or wrote
+    unsigned long long symbols; // Number of symbols the phase handled
+} PhaseStats;
+
+// Statistics of (de-)compression, only filled if the program is built with HUFFMAN_STATS
+typedef struct codecStats{
+    PhaseStats phases[NUMBER_PHASES]; // Time and amount of data of every phase
+    double wallSeconds; // Time from the start to the end of every call, summed over all calls
+    unsigned long long rawBytes; // Uncompressed bytes of all blocks
+    unsigned long long compressedBytes; // Bytes of all block frames, frame headers included
+    unsigned long long blocks[NUMBER_BLOCK_MODES]; // Number of blocks in every block mode
+    unsigned long long codedSymbols; // Number of symbols of the blocks coded with Huffman codes
+    unsigned long long countedSymbols; // Number of those symbols whose characters were counted, only when compressing
+    unsigned long long codedBits; // Bits of the codes of the counted symbols without code tables and padding
+    double entropyBits; // Order-0 entropy of the counted symbols from the frequencies of every block
+} CodecStats;
+
+// Settings of the compressor and decompressor
+typedef struct codecOptions{
+    size_t blockSize; // Number of input bytes coded independently in one block
+    int numberThreads; // Number of worker threads coding blocks in parallel
+    int maxCodeLength; // Longest code the compressor may produce, between MIN_CODE_LENGTH_LIMIT (8) and MAX_CODE_LENGTH bits
+    const Dictionary* dictionary; // Dictionary to compress with and to decompress files that need it, NULL for none
+    int numberStreams; // Number of bit streams per compressed block, 1 or 4 for faster decoding
+    int verbose; // 1 to print progress and statistics, 0 to stay quiet so stdout can carry the data
+    CodecStats* stats; // Statistics every call adds to, NULL for none, stays empty if the program is built without HUFFMAN_STATS
+} CodecOptions;
+
+// Streaming encoder, holds one block of input and the output not yet handed to the caller, so its memory does not grow with the input
+typedef struct huffmanEncoder{
+    size_t blockSize; // Number of input bytes coded in one block
+    int maxCodeLength; // Longest code the encoder may produce
+    BlockFormat format; // Dictionary and number of bit streams of the blocks
+    unsigned char* block; // Input collected for the next block
+    size_t blockLength; // Number of bytes in block
+    ByteBuffer compressed; // Compressed block, reused for every block
+    ByteBuffer pending; // Output not yet copied to the caller
+    size_t pendingPosition; // Number of bytes of pending already copied to the caller
+    ByteBuffer index; // Positions of the block frames, written at the end (8 bytes per block)
+    Arena arena; // Tree and code table of the block being compressed
+    TableReference reference; // Last code table stored in a block, which later blocks can reuse
+    unsigned long long blockCount; // Number of blocks written
+    unsigned long long position; // Number of output bytes produced so far
+    int finished; // 1 once the end frame, index and footer are in pending
+    CodecStats* stats; // Statistics of the blocks, NULL for none
+} HuffmanEncoder;
+
+// Streaming decoder, holds one compressed block and its decompressed content
+typedef struct huffmanDecoder{
+    int state; // Part of the file expected next, see the DECODER_ constants in huffman_code.c
+    const Dictionary* dictionary; // Dictionary given by the caller, NULL for none
+    BlockFormat format; // Format of the blocks of the current file, from its container header
+    unsigned char collected[16]; // Container header (with the dictionary ID) or frame header being collected
+    size_t collectedLength; // Number of bytes in collected
+    size_t blockSize; // Block size from the container header
+    size_t rawLength; // Uncompressed length of the current frame
+    size_t compressedLength; // Compressed length of the current frame
+    ByteBuffer frame; // Compressed block being collected
+    ByteBuffer decoded; // Decompressed block not yet copied to the caller
+    size_t decodedPosition; // Number of bytes of decoded already copied to the caller
+    Arena arena; // Code table and decode table of the block being decompressed
+    TableReference reference; // Last code table stored in a block, for blocks reusing it
+    unsigned long long blockIndex; // Index of the current block
+    CodecStats* stats; // Statistics of the blocks, NULL for none
+} HuffmanDecoder;
+
+#ifdef _WIN32
+typedef HANDLE Thread;
+typedef CRITICAL_SECTION Mutex;
+typedef CONDITION_VARIABLE Condition;
+#else
+typedef pthread_t Thread;
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t Condition;
+#endif
+
+// Blocks shared between the worker threads and the thread writing the results in order
+typedef struct blockPool{
+    int compress; // 1 to compress blocks, 0 to decompress them
+    const unsigned char* input; // Whole input, uncompressed data or the compressed file
+    size_t inputLength; // Number of bytes in input
+    size_t blockSize; // Number of uncompressed bytes per block
+    size_t blockCount; // Number of blocks
+    const unsigned long long* frameOffsets; // Position of every block frame in input, only used to decompress
+    int maxCodeLength; // Longest code the compressor may produce, only used to compress
+    BlockFormat format; // Dictionary and number of bit streams of the blocks
+    TableReference reference; // Last code table stored in a block, handed from block to block in order, only used to compress
+    size_t decidedBlocks; // Number of blocks whose mode is chosen, modes are chosen in block order because they depend on reference
+    ByteBuffer* results; // One result per slot, block b uses slot b % window
+    int* resultReady; // 1 once the result of a slot can be written
+    size_t window; // Number of blocks that can be in flight at once, bounds the memory use
+    size_t nextBlock; // Next block to hand out to a worker
+    size_t writtenBlocks; // Number of blocks already written, in order
+    int failed; // 1 once a block could not be coded
+    CodecStats* stats; // Statistics of all threads, every thread counts on its own and adds its counts at the end, NULL for none
+    Mutex mutex; // Protects the fields above that change
+    Condition condition; // Signals finished blocks and freed slots
+} BlockPool;
+
+// Names of the files of the batch mode, grown as names are added
+typedef struct fileList{
+    char** names; // Copies of the names
+    size_t count; // Number of names
+    size_t capacity; // Number of names names can hold
+} FileList;
+
+// Input or output name of one file of the batch mode, sorted to find files that would write the same output or read another's output
+typedef struct batchName{
+    const char* name; // Input or output name
+    size_t file; // Index of the file in the file list
+} BatchName;
+
+// Files shared between the worker threads of the batch mode
+typedef struct batchJob{
+    const FileList* files; // Files to (de-)compress
+    int mode; // 1 to compress, 2 to decompress, 0 to decide from the name of every file
+    char** outputNames; // Name of the output of every file, NULL for files that cannot be coded
+    const CodecOptions* options; // Settings of the encoders and decoders
+    size_t nextFile; // Next file to hand out to a worker
+    size_t failedFiles; // Number of files that could not be coded
+    unsigned long long inputBytes; // Bytes read from all files coded so far
+    unsigned long long outputBytes; // Bytes written for all files coded so far
+    Mutex mutex; // Protects the fields above that change
+} BatchJob;
+
+// State of one worker thread of the batch mode, allocated once and reused for every file
+typedef struct batchWorker{
+    BatchJob* job; // Files shared with the other workers
+    HuffmanEncoder encoder; // Encoder reset for every file, only set up if the job compresses
+    HuffmanDecoder decoder; // Decoder reset for every file
+    int hasEncoder; // 1 if encoder was set up
+    unsigned char* inBuffer; // Chunk of the input being read
+    unsigned char* outBuffer; // Chunk of the output being written
+    CodecStats stats; // Statistics of this worker, added to those of the options at the end
+} BatchWorker;
+
 #endif
\ No newline at end of file